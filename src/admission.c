@@ -0,0 +1,118 @@
+/*
+ * admission.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <string.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The tokens are counted in thousandths, so that a refill of a fraction
+// of a token per call is not lost to the rounding.
+#define TOKEN 1000
+#define BURST 2
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+admission_init (admission_t* adm, int rate)
+{
+  memset (adm, 0, sizeof (*adm));
+  adm->rate = rate;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bucket_t*
+admission_bucket (admission_t* adm, uid_t uid, long long now)
+{
+  bucket_t* it;
+  bucket_t* oldest = adm->buckets;
+  bucket_t* end = adm->buckets + adm->n_buckets;
+
+  for (it = adm->buckets; it < end; it++)
+    {
+      if (it->uid == uid)
+        return it;
+      else if (it->stamp < oldest->stamp)
+        oldest = it;
+    }
+
+  // The least recently seen peer is evicted when the table is full,
+  // its bucket was most likely refilled already.
+  if (adm->n_buckets < ADMISSION_SIZE)
+    it = adm->buckets + adm->n_buckets++;
+  else
+    it = oldest;
+
+  memset (it, 0, sizeof (*it));
+  it->uid = uid;
+  it->tokens = (long long) adm->rate * BURST * TOKEN;
+  it->stamp = now;
+
+  return it;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+admission_check (admission_t* adm, uid_t uid, pid_t pid)
+{
+  long long now = latency_now ();
+  long long full = (long long) adm->rate * BURST * TOKEN;
+  long long refill;
+  bucket_t* b;
+
+  if (adm->rate <= 0)
+    return true;
+
+  b = admission_bucket (adm, uid, now);
+  // The stamp moves on only by the time that was credited, the rest is
+  // left for the next call. The bucket is full after BURST seconds, a
+  // longer pause would only overflow the product with a large rate.
+  refill = MIN (now - b->stamp, BURST * 1000000000LL) * adm->rate / 1000000;
+  b->tokens += refill;
+  b->stamp += refill * 1000000 / adm->rate;
+  b->pid = pid;
+
+  if (b->tokens >= full)
+    {
+      b->tokens = full;
+      b->stamp = now;
+    }
+
+  if (b->tokens >= TOKEN)
+    {
+      b->tokens -= TOKEN;
+      adm->admitted++;
+      return true;
+    }
+
+  b->throttled++;
+  adm->throttled++;
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+admission_format (admission_t const* adm, int index, char* dest, int size)
+{
+  bucket_t const* b;
+
+  if (index < 0)
+    return snprintf (dest, size,
+                     "admission: rate=%d/s admitted=%lld throttled=%lld",
+                     adm->rate, adm->admitted, adm->throttled);
+  else if (index >= adm->n_buckets)
+    return 0;
+
+  b = adm->buckets + index;
+
+  return snprintf (dest, size, "admission.uid%d: pid=%d throttled=%lld",
+                   (int) b->uid, (int) b->pid, b->throttled);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,46 @@
+/*
+ * admission.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_ADMISSION_H_
+#define SRC_ADMISSION_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <sys/types.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define ADMISSION_SIZE 16
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A token bucket of one peer. The buckets are keyed by uid: the command
+// line client is a new process, and so a new pid, for every command.
+typedef struct bucket_t
+{
+  uid_t uid;
+  pid_t pid;
+  long long tokens;
+  long long stamp;
+  long long throttled;
+} bucket_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct admission_t
+{
+  int rate;
+  int n_buckets;
+  long long admitted;
+  long long throttled;
+  bucket_t buckets[ADMISSION_SIZE];
+} admission_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void admission_init (admission_t* adm, int rate);
+bool_t admission_check (admission_t* adm, uid_t uid, pid_t pid);
+int admission_format (admission_t const* adm, int index, char* dest, int size);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_ADMISSION_H_ */
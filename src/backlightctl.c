@@ -0,0 +1,627 @@
+/*
+ * backlightctl.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include "includes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The commands sent and not answered yet, and the input read at once.
+#define BLCTL_MAX_PENDING 64
+#define BLCTL_INPUT (16 * sizeof (message_t))
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+_Static_assert (BLCTL_EVENT_TARGET == (int) WATCH_TARGET
+                    && BLCTL_EVENT_REMOVED == (int) WATCH_REMOVED,
+                "The events of the library are those of the daemon");
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct blctl_pending_t
+{
+  blctl_reply_func_t func;
+  void* data;
+  message_t msg;
+} blctl_pending_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The answer waited for in place, copied to 'reply' or passed to 'func'.
+typedef struct blctl_answer_t
+{
+  bool_t done;
+  int status;
+  char* reply;
+  int size;
+  blctl_reply_func_t func;
+  void* data;
+} blctl_answer_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The commands are kept in the order of their answers: the first 'n_sent'
+// of them are on the way, the rest wait for a held answer to come. 'text'
+// collects the output of the oldest one. A subscribed handle has
+// 'on_event', and 'acked' once the daemon has taken the subscription.
+struct blctl_t
+{
+  char* socketname;
+  int fd;
+  bool_t wait;
+
+  blctl_pending_t queue[BLCTL_MAX_PENDING];
+  int head;
+  int count;
+  int n_sent;
+
+  char* text;
+  int text_len;
+  int text_size;
+  int status;
+
+  blctl_event_func_t on_event;
+  void* event_data;
+  int granularity;
+  bool_t acked;
+
+  int in_len;
+  char in[BLCTL_INPUT];
+};
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+blctl_subscribe (blctl_t* self)
+{
+  message_t msg = MESSAGE_INIT;
+
+  msg.field = FIELD_WATCH;
+  msg.v_int = self->granularity;
+  self->acked = false;
+
+  return (send (self->fd, &msg, sizeof (msg), MSG_NOSIGNAL) == sizeof (msg));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+blctl_connect (blctl_t* self)
+{
+  int fd, rc;
+
+  if ((fd = fs_open_socket (self->socketname, (sock_func_t) connect)) < 0)
+    return false;
+
+  // The new connection takes the number of the old one, so the poll set
+  // of the program goes on working.
+  if (self->fd < 0)
+    self->fd = fd;
+  else if (dup3 (fd, self->fd, O_CLOEXEC) < 0)
+    {
+      rc = errno;
+      close (fd);
+      errno = rc;
+      return false;
+    }
+  else
+    close (fd);
+
+  self->in_len = 0;
+
+  return (!self->on_event || blctl_subscribe (self));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+blctl_append (blctl_t* self, char const* line)
+{
+  int len = strlen (line) + 1;
+  char* text;
+
+  if (self->text_len + len >= self->text_size)
+    {
+      if (!(text = realloc (self->text, self->text_len + len + BUFFER_SIZE)))
+        return;
+
+      self->text = text;
+      self->text_size = self->text_len + len + BUFFER_SIZE;
+    }
+
+  self->text_len += sprintf (self->text + self->text_len, "%s%s",
+                             self->text_len ? "\n" : "", line);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+blctl_finish (blctl_t* self, int status, char const* error)
+{
+  blctl_pending_t it = self->queue[self->head];
+  char* text;
+  int size;
+
+  self->head = (self->head + 1) % BLCTL_MAX_PENDING;
+  self->count--;
+  self->n_sent = MAX (self->n_sent - 1, 0);
+
+  if (error)
+    {
+      self->text_len = 0;
+      blctl_append (self, error);
+    }
+
+  if (self->text)
+    self->text[self->text_len] = 0;
+
+  // The buffer is taken from the handle for the time of the callback,
+  // which may send the next command.
+  text = self->text;
+  size = self->text_size;
+  self->text = null;
+  self->text_len = 0;
+  self->text_size = 0;
+  self->status = 0;
+
+  if (it.func)
+    it.func (self, status, text ? text : "", it.data);
+
+  if (self->text)
+    ckfree (text);
+  else
+    {
+      self->text = text;
+      self->text_size = size;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+blctl_fail (blctl_t* self, int n, int error)
+{
+  char const* text = strerror (error);
+
+  while (n-- > 0 && self->count > 0)
+    blctl_finish (self, -1, text);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+blctl_drop (blctl_t* self, int error)
+{
+  // Without a connection nothing is sent, the commands waiting for one
+  // fail too.
+  set_fd (self->fd, -1);
+  self->in_len = 0;
+  blctl_fail (self, self->count, error);
+  errno = error;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+blctl_flush (blctl_t* self)
+{
+  blctl_pending_t* it;
+  bool_t again = true;
+  int rc;
+
+  while (self->n_sent < self->count)
+    {
+      it = self->queue + (self->head + self->n_sent) % BLCTL_MAX_PENDING;
+
+      // A held answer would come after the answers to the commands sent
+      // behind it, so the command that waits goes alone.
+      if (self->n_sent > 0
+          && (it->msg.wait || self->queue[self->head].msg.wait))
+        break;
+
+      if (self->fd >= 0
+          && send (self->fd, &it->msg, sizeof (it->msg), MSG_NOSIGNAL)
+                 == sizeof (it->msg))
+        {
+          self->n_sent++;
+          continue;
+        }
+
+      // The connection closed by the daemon is made again once. The
+      // commands on the way may have been done or not, they fail.
+      rc = (self->fd < 0) ? ENOTCONN : errno;
+      blctl_fail (self, self->n_sent, rc);
+
+      if (again && blctl_connect (self))
+        {
+          again = false;
+          continue;
+        }
+
+      blctl_drop (self, again ? errno : rc);
+      return false;
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+blctl_event (blctl_t* self, watch_event_t* ev)
+{
+  blctl_event_t out;
+
+  ev->device[sizeof (ev->device) - 1] = 0;
+
+  out.type = (blctl_event_type_t) ev->type;
+  out.device = ev->device;
+  out.value = ev->value;
+  out.target = ev->target;
+  out.max = ev->max;
+  out.level = ev->level;
+
+  self->on_event (self, &out, self->event_data);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+blctl_answer (blctl_t* self, message_t* msg)
+{
+  char value[16];
+
+  msg->v_str[sizeof (msg->v_str) - 1] = 0;
+
+  // The answer to the subscription, the events follow it.
+  if (self->on_event)
+    {
+      if (msg->type != TYPE_ERROR)
+        return (self->acked = true);
+
+      self->on_event = null;
+      errno = EAGAIN;
+      return false;
+    }
+  else if (self->n_sent == 0)
+    return true;
+
+  switch (msg->type)
+    {
+    case TYPE_INT:
+      snprintf (value, sizeof (value), "%d", msg->v_int);
+      blctl_append (self, value);
+      break;
+
+    case TYPE_STRING:
+      blctl_append (self, msg->v_str);
+      break;
+
+    case TYPE_ERROR:
+      self->status = -1;
+      self->text_len = 0;
+      blctl_append (self, msg->v_str);
+      break;
+
+    default:
+      break;
+    }
+
+  if (msg->read_more)
+    return true;
+
+  blctl_finish (self, self->status, null);
+
+  return blctl_flush (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+blctl_receive (blctl_t* self, int flags)
+{
+  union
+  {
+    message_t msg;
+    watch_event_t ev;
+  } unit;
+  int rc, size;
+  bool_t result = true;
+
+  if (self->fd < 0)
+    {
+      errno = ENOTCONN;
+      return -1;
+    }
+
+  rc = recv (self->fd, self->in + self->in_len,
+             sizeof (self->in) - self->in_len, flags);
+
+  if (rc < 0 && (errno == EAGAIN || errno == EINTR))
+    return 0;
+  else if (rc <= 0)
+    {
+      // The daemon has gone away or restarted: the commands on the way
+      // fail, the rest and the subscription go to the new connection.
+      blctl_fail (self, self->n_sent, rc ? errno : ECONNRESET);
+
+      if (!blctl_connect (self) || !blctl_flush (self))
+        {
+          blctl_drop (self, errno);
+          return -1;
+        }
+
+      return 1;
+    }
+
+  self->in_len += rc;
+
+  // Each unit is taken out of the buffer before its callback, which may
+  // read the connection too.
+  while (result)
+    {
+      size = (self->on_event && self->acked) ? sizeof (unit.ev)
+                                              : sizeof (unit.msg);
+
+      if (self->fd < 0 || self->in_len < size)
+        break;
+
+      memcpy (&unit, self->in, size);
+      self->in_len -= size;
+      memmove (self->in, self->in + size, self->in_len);
+
+      if (size == sizeof (unit.ev))
+        blctl_event (self, &unit.ev);
+      else
+        result = blctl_answer (self, &unit.msg);
+    }
+
+  return result ? rc : -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+blctl_collect (blctl_t* ctl, int status, char const* text, void* data)
+{
+  blctl_answer_t* answer = (blctl_answer_t*) data;
+
+  answer->done = true;
+  answer->status = status;
+
+  if (answer->reply && answer->size > 0)
+    snprintf (answer->reply, answer->size, "%s", text);
+
+  if (answer->func)
+    answer->func (ctl, status, text, answer->data);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+blctl_await (blctl_t* self, message_t const* msg, blctl_answer_t* answer)
+{
+  if (blctl_request (self, msg, blctl_collect, answer) < 0)
+    return -1;
+
+  // A lost connection fails the command, so the answer is not left in
+  // the queue when the loop ends.
+  while (!answer->done)
+    if (blctl_receive (self, 0) < 0)
+      break;
+
+  return answer->done ? answer->status : -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+blctl_parse (blctl_t* self, char const* command, message_t* msg)
+{
+  char line[BUFFER_SIZE];
+
+  *msg = (message_t) MESSAGE_INIT;
+  snprintf (line, sizeof (line), "%s", command ? command : "");
+
+  if (!message_parse (line, msg))
+    return false;
+
+  switch (msg->field)
+    {
+    case FIELD_WATCH:
+      _seterrf (msg->v_str, "%s", "A subscription is made by blctl_watch()");
+      return false;
+
+    case FIELD_RING:
+      _seterrf (msg->v_str, "%s", "The ring is not passed to the library");
+      return false;
+
+    default:
+      msg->wait = self->wait;
+      return true;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_request (blctl_t* self, message_t const* msg, blctl_reply_func_t func,
+               void* data)
+{
+  blctl_pending_t* it;
+
+  if (self->on_event)
+    {
+      errno = EBUSY;
+      return -1;
+    }
+  else if (self->count >= BLCTL_MAX_PENDING)
+    {
+      errno = EAGAIN;
+      return -1;
+    }
+
+  it = self->queue + (self->head + self->count) % BLCTL_MAX_PENDING;
+  it->func = func;
+  it->data = data;
+  it->msg = *msg;
+  self->count++;
+
+  // A failure to send is told to the callback.
+  blctl_flush (self);
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_send (blctl_t* self, message_t const* msg, blctl_reply_func_t func,
+            void* data)
+{
+  blctl_answer_t answer = { false, -1, null, 0, func, data };
+
+  return blctl_await (self, msg, &answer);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+blctl_t*
+blctl_open (char const* socketname)
+{
+  blctl_t* self;
+
+  if (!(self = calloc (1, sizeof (*self))))
+    return null;
+
+  self->fd = -1;
+
+  if (socketname)
+    self->socketname = strdup (socketname);
+  else
+    self->socketname = fs_path_join (statics_defaults[DEFAULT_WORKDIR].v_str,
+                                     statics_defaults[DEFAULT_SOCKET].v_str,
+                                     null);
+
+  if (!self->socketname)
+    {
+      ckfree (self);
+      return null;
+    }
+
+  blctl_connect (self);
+
+  return self;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+blctl_close (blctl_t* self)
+{
+  if (!self)
+    return;
+
+  set_fd (self->fd, -1);
+  ckfree (self->text);
+  ckfree (self->socketname);
+  ckfree (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_fd (blctl_t const* self)
+{
+  return self->fd;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_dispatch (blctl_t* self)
+{
+  int rc;
+
+  if (self->fd < 0)
+    {
+      if (!blctl_connect (self))
+        {
+          blctl_drop (self, errno);
+          return -1;
+        }
+
+      return blctl_flush (self) ? 0 : -1;
+    }
+
+  while ((rc = blctl_receive (self, MSG_DONTWAIT)) > 0)
+    continue;
+
+  return rc;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_call (blctl_t* self, char const* command, char* reply, int size)
+{
+  blctl_answer_t answer = { false, -1, reply, size, null, null };
+  message_t msg;
+  int rc;
+
+  if (!blctl_parse (self, command, &msg))
+    {
+      if (reply && size > 0)
+        snprintf (reply, size, "%s", msg.v_str);
+
+      errno = EINVAL;
+      return -1;
+    }
+
+  if ((rc = blctl_await (self, &msg, &answer)) < 0 && !answer.done && reply
+      && size > 0)
+    snprintf (reply, size, "%s", strerror (errno));
+
+  return rc;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_call_async (blctl_t* self, char const* command, blctl_reply_func_t func,
+                  void* data)
+{
+  message_t msg;
+
+  if (!blctl_parse (self, command, &msg))
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  return blctl_request (self, &msg, func, data);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+blctl_set_wait (blctl_t* self, int wait)
+{
+  self->wait = (wait != 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+blctl_watch (blctl_t* self, int granularity, blctl_event_func_t func,
+             void* data)
+{
+  if (!func || self->on_event || self->count > 0)
+    {
+      errno = EBUSY;
+      return -1;
+    }
+
+  self->on_event = func;
+  self->event_data = data;
+  self->granularity = granularity;
+
+  if (!(self->fd >= 0 && blctl_subscribe (self)) && !blctl_connect (self))
+    {
+      self->on_event = null;
+      return -1;
+    }
+
+  while (self->on_event && !self->acked)
+    if (blctl_receive (self, 0) < 0)
+      break;
+
+  return (self->on_event && self->acked) ? 0 : -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+/*
+ * backlightctl.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_BACKLIGHTCTL_H_
+#define SRC_BACKLIGHTCTL_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// libbacklightctl, the client side of the socket of the daemon for the
+// programs that change the brightness without starting backlight-ctl.
+//
+// A handle keeps one connection open and makes it again when the daemon
+// goes away or restarts. The commands are the lines of the text protocol,
+// 'COMMAND [VALUE] [DEVICE]' with the names of the command line ("up",
+// "set 40%", "transition 300 intel_backlight"), and are sent as binary
+// messages. blctl_call() waits for the answer, blctl_call_async() returns
+// at once and the answer comes to its callback from blctl_dispatch(),
+// which is called when blctl_fd() is readable. The answers come in the
+// order of the commands.
+//
+// A handle given to blctl_watch() gets the events of the daemon and takes
+// no commands, those go through another handle.
+//
+// The handles are not thread safe.
+#ifdef __cplusplus
+extern "C" {
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#if defined(__GNUC__)
+#define BLCTL_API __attribute__ ((visibility ("default")))
+#else
+#define BLCTL_API
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct blctl_t blctl_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The events of 'backlight-ctl watch': TARGET when a device is given a new
+// target, VALUE when its brightness moves, DONE when it reaches the target
+// or stops short of it, ADDED and REMOVED for the devices taken and
+// released by the daemon.
+typedef enum blctl_event_type_t
+{
+  BLCTL_EVENT_TARGET,
+  BLCTL_EVENT_VALUE,
+  BLCTL_EVENT_DONE,
+  BLCTL_EVENT_ADDED,
+  BLCTL_EVENT_REMOVED
+} blctl_event_type_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'level' is -1 when the device is off. 'device' is valid during the
+// callback only.
+typedef struct blctl_event_t
+{
+  blctl_event_type_t type;
+  char const* device;
+  int value;
+  int target;
+  int max;
+  int level;
+} blctl_event_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'status' is 0 when the command is done and 'text' holds its output
+// lines, -1 when it failed and 'text' is the error.
+typedef void (*blctl_reply_func_t) (blctl_t* ctl, int status, char const* text,
+                                    void* data);
+typedef void (*blctl_event_func_t) (blctl_t* ctl, blctl_event_t const* ev,
+                                    void* data);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The socket is the one of the daemon in its default working directory
+// when 'socketname' is null. Null is returned only when the memory runs
+// out. The handle is returned even when the daemon can not be reached:
+// blctl_fd() is -1 then, errno tells why, and the connection is tried
+// again by the first call.
+BLCTL_API blctl_t* blctl_open (char const* socketname);
+BLCTL_API void blctl_close (blctl_t* ctl);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The descriptor to wait on for reading, -1 while there is no connection.
+// It keeps its number when the connection is made again.
+BLCTL_API int blctl_fd (blctl_t const* ctl);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Calls the callbacks of the answers and the events that have come,
+// without blocking. Returns -1 and sets errno when the connection is lost
+// and can not be made again.
+BLCTL_API int blctl_dispatch (blctl_t* ctl);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Sends the command and waits for its answer, which is copied to 'reply'
+// when it is not null. Returns 0 or -1.
+BLCTL_API int blctl_call (blctl_t* ctl, char const* command, char* reply,
+                          int size);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Sends the command, 'func' gets its answer. Returns -1 when the command
+// is not sent, the callback is not called then.
+BLCTL_API int blctl_call_async (blctl_t* ctl, char const* command,
+                                blctl_reply_func_t func, void* data);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// With 'wait' set the answers to the commands sent after it are held
+// until the transitions they started are over, like --wait.
+BLCTL_API void blctl_set_wait (blctl_t* ctl, int wait);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Subscribes the handle to the events, with the VALUE events whenever the
+// brightness moves by 'granularity' percent of the maximum, none of them
+// when it is negative. The current devices come first as ADDED. Returns
+// 0 or -1.
+BLCTL_API int blctl_watch (blctl_t* ctl, int granularity,
+                           blctl_event_func_t func, void* data);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_BACKLIGHTCTL_H_ */
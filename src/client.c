@@ -11,8 +11,8 @@
 #include "includes.h"
 
 #include <errno.h>
-#include <fcntl.h>
-#include <signal.h>
+#include <sched.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -20,111 +20,323 @@
 #include <unistd.h>
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-static inline char**
-read_proc_commandline (int pid)
+// A restarted server closes the subscribers, they come back to the new one
+// for this long.
+#define WATCH_RETRIES 20
+#define WATCH_RETRY_DELAY 100000
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+client_execute_stop_restart (client_t* self)
 {
-  char** retval = null;
-  char* path;
-  int retlen = 0;
+  message_t msg;
+  bool_t result = false;
+  char c;
   int fd;
 
-  path = fs_stringf ("/proc/%i/cmdline", pid);
+  // The server answers with its PID and closes the connection after it
+  // has saved the state and released the devices. A restarted one is
+  // already starting over at that moment.
+  if ((fd = fs_open_socket (self->socketname, (sock_func_t) connect)) == -1)
+    eprintf ("The server is not running: %s", strerror (errno));
+  else if (write (fd, &self->msg, sizeof (self->msg)) < 0)
+    eprintf ("%s", strerror (errno));
+  else if (read (fd, &msg, sizeof (msg)) != sizeof (msg))
+    eprintf ("%s", "Received a broken message");
+  else if (msg.type == TYPE_ERROR)
+    eprintf ("%s", msg.v_str);
+  else
+    {
+      while (read (fd, &c, sizeof (c)) > 0)
+        continue;
+
+      result = true;
+    }
+
+  set_fd (fd, -1);
 
-  if ((fd = open (path, O_RDONLY)) > -1)
+  return result;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+print_rate (char const* what, int count, long long took)
+{
+  printf ("%d %s in %lldus, %lld %s/s\n", count, what, took / 1000,
+          count * 1000000000LL / MAX (took, 1LL), what);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+client_print_status (client_t* self, statpage_device_t const* dev)
+{
+  if (!*dev->name || (*self->device && strcmp (dev->name, self->device)))
+    return;
+
+  printf ("%s: %d/%d", dev->name, dev->value, dev->max);
+
+  if (dev->blanked || dev->level < 0)
+    printf (" off");
+  else
+    printf (" level %d/%d", dev->level, dev->num_levels);
+
+  if (dev->progress < 1000)
+    printf (" -> %d (%d%%)", dev->target, dev->progress / 10);
+
+  printf ("\n");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+client_execute_status (client_t* self)
+{
+  statpage_device_t devs[SCHED_MAX_DEVICES];
+  statpage_t const* page;
+  long long start, took;
+  char* path;
+  int i, n = -1;
+
+  path = fs_path_join (self->workdir, statics_defaults[DEFAULT_STATUS].v_str,
+                       null);
+
+  if (!(page = statpage_open (path)))
+    eprintf ("%s: %s", path, strerror (errno));
+  else
     {
-      char *str, *p, c;
+      start = latency_now ();
 
-      str = p = malloc (256);
+      for (i = 0; i < MAX (self->repeat, 1); i++)
+        n = statpage_read (page, devs, SCHED_MAX_DEVICES);
 
-      while (read (fd, &c, sizeof (c)) == sizeof (c))
-        {
-          *p++ = c;
-
-          if (c == 0)
-            {
-              retval = realloc (retval, sizeof (str) * (retlen + 2));
-              retval[retlen++] = strdup (str);
-              retval[retlen] = null;
-              p = str;
-              *p = 0;
-            }
-        }
+      took = latency_now () - start;
 
-      set_fd (fd, -1);
-      ckfree (str);
+      if (n < 0 && errno == ESRCH)
+        eprintf ("%s", "The server is not running");
+      else if (n < 0)
+        eprintf ("%s", strerror (errno));
+
+      for (i = 0; i < n; i++)
+        client_print_status (self, devs + i);
+
+      if (n >= 0 && self->repeat > 1)
+        print_rate ("reads", self->repeat, took);
+
+      statpage_close (page);
     }
-  else
-    eprintf ("%s", strerror (errno));
 
   ckfree (path);
 
-  return retval;
+  if (n >= 0)
+    printf ("Done\n");
+
+  return (n >= 0);
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
-client_execute_stop_restart (client_t* self)
+client_execute_ring (client_t* self)
 {
-  int pid = 0, fd;
-  bool_t result = false;
+  message_t req = MESSAGE_INIT, rep;
+  cmdring_cmd_t cmd = { 0 };
+  cmdring_t* ring = null;
+  int fds[2] = { -1, -1 };
+  uint64_t one = 1;
+  long long start;
+  bool_t result = true;
+  bool_t pushed;
+  int sock, i;
+
+  switch (self->msg.field)
+    {
+    case FIELD_INC:
+    case FIELD_DEC:
+    case FIELD_ON:
+    case FIELD_OFF:
+    case FIELD_SWITCH:
+    case FIELD_SET:
+      break;
+    default:
+      eprintf ("%s", "Only the brightness commands go through the ring");
+      return false;
+    }
 
-  if (fs_test (self->pidfile, FS_EXISTS))
+  // The ring and its eventfd are handed out over the socket once.
+  req.field = FIELD_RING;
+
+  if ((sock = fs_open_socket (self->socketname, (sock_func_t) connect)) < 0
+      || write (sock, &req, sizeof (req)) != sizeof (req))
+    eprintf ("%s", strerror (errno));
+  else if (fs_recv_fds (sock, &rep, sizeof (rep), fds, 2) != sizeof (rep))
+    eprintf ("%s", "Received a broken message");
+  else if (rep.type == TYPE_ERROR)
+    eprintf ("%s", rep.v_str);
+  else if (fds[1] < 0 || !(ring = cmdring_attach (fds[0])))
+    eprintf ("%s", "The server did not pass the ring");
+
+  set_fd (sock, -1);
+
+  cmd.field = self->msg.field;
+  cmd.value = self->msg.v_int;
+  memcpy (cmd.device, self->device, sizeof (cmd.device));
+  start = latency_now ();
+
+  for (i = 0; ring && result && i < MAX (self->repeat, 1); i++)
     {
-      if ((fd = open (self->pidfile, O_RDONLY)) == -1)
-        eprintf ("%s", strerror (errno));
-      else
+      cmd.stamp = latency_now ();
+
+      // The server drains the whole ring at once, a full one is free
+      // again in a moment. One that stays full is not read any more.
+      while (!(pushed = cmdring_push (ring, &cmd))
+             && latency_now () - cmd.stamp < CMDRING_STALL)
+        sched_yield ();
+
+      if (!pushed)
         {
-          pid = fs_getint (fd);
-          set_fd (fd, -1);
+          eprintf ("%s", "The server does not take the commands");
+          result = false;
         }
+      else
+        result = (write (fds[1], &one, sizeof (one)) == sizeof (one));
     }
-  else if (fs_test (self->socketname, FS_IS_SOCK))
-    {
-      message_t msg;
 
-      if ((fd = fs_open_socket (self->socketname, (sock_func_t) connect)) == -1)
-        eprintf ("%s", strerror (errno));
-      else if (write (fd, &self->msg, sizeof (self->msg)) < 0)
-        eprintf ("%s", strerror (errno));
-      else if (read (fd, &msg, sizeof (msg)) == sizeof (msg))
-        pid = msg.type == TYPE_INT ? msg.v_int : 0;
-      set_fd (fd, -1);
-    }
+  if (ring && result && self->repeat > 1)
+    print_rate ("commands", self->repeat, latency_now () - start);
+
+  cmdring_destroy (ring);
+  set_fd (fds[0], -1);
+  set_fd (fds[1], -1);
+
+  if (ring && result)
+    printf ("Done\n");
+
+  return (ring && result);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+client_execute_dgram (client_t* self)
+{
+  long long start;
+  bool_t result;
+  char* path;
+  int sock, i;
 
-  if (pid > 0)
+  switch (self->msg.field)
     {
-      char **cmdline, **it;
+    case FIELD_INC:
+    case FIELD_DEC:
+    case FIELD_ON:
+    case FIELD_OFF:
+    case FIELD_SWITCH:
+    case FIELD_SET:
+      break;
+    default:
+      eprintf ("%s", "Only the brightness commands can be sent without waiting");
+      return false;
+    }
 
-      cmdline = read_proc_commandline (pid);
+  // One datagram per command and no answer: the server does not learn
+  // about the client until the command is already queued.
+  path = fs_stringf ("%s" DGRAM_SUFFIX, self->socketname);
+  sock = fs_open_socket_type (path, SOCK_DGRAM, (sock_func_t) connect);
+  memcpy (self->msg.device, self->device, sizeof (self->device));
+  result = (sock >= 0);
+  start = latency_now ();
 
-      if (kill (pid, SIGINT) == -1)
-        eprintf ("%s", strerror (errno));
-      else if (self->msg.field == FIELD_RESTART && cmdline)
+  for (i = 0; result && i < MAX (self->repeat, 1); i++)
+    result = (send (sock, &self->msg, sizeof (self->msg), 0)
+              == sizeof (self->msg));
+
+  if (!result)
+    eprintf ("%s: %s", path, strerror (errno));
+  else if (self->repeat > 1)
+    print_rate ("commands", self->repeat, latency_now () - start);
+
+  set_fd (sock, -1);
+  ckfree (path);
+
+  return result;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+client_print_event (client_t* self, watch_event_t const* ev)
+{
+  char line[WATCH_LINE_SIZE];
+
+  if (*self->device && strcmp (ev->device, self->device))
+    return;
+
+  // The same line as the subscribers of the text protocol get.
+  watch_format (ev, line, sizeof (line));
+  fputs (line, stdout);
+  fflush (stdout);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+client_execute_watch (client_t* self)
+{
+  message_t req = self->msg, rep;
+  watch_event_t ev;
+  int fd, tries = WATCH_RETRIES;
+
+  req.v_int = self->granularity;
+
+  // Only the first connection has to succeed, the later ones follow the
+  // restarts of the server.
+  while ((fd = fs_open_socket (self->socketname, (sock_func_t) connect)) >= 0
+         || tries < WATCH_RETRIES)
+    {
+      if (fd < 0 || write (fd, &req, sizeof (req)) != sizeof (req)
+          || read (fd, &rep, sizeof (rep)) != sizeof (rep))
         {
-          context_destroy ((context_t*) self);
+          set_fd (fd, -1);
+
+          if (++tries >= WATCH_RETRIES)
+            break;
 
-          if (!(result = (execvp (cmdline[0], cmdline) == 0)))
-            eprintf ("%s", strerror (errno));
-          _exit (0);
+          usleep (WATCH_RETRY_DELAY);
+          continue;
         }
-      else
-        result = true;
+      else if (rep.type == TYPE_ERROR)
+        {
+          eprintf ("%s", rep.v_str);
+          set_fd (fd, -1);
+          return false;
+        }
+
+      while (read (fd, &ev, sizeof (ev)) == sizeof (ev))
+        client_print_event (self, &ev);
 
-      for (it = cmdline; it && *it; it++)
-        ckfree (*it);
-      ckfree (cmdline);
+      set_fd (fd, -1);
+      tries = 0;
     }
 
-  return result;
+  eprintf ("The server is not running: %s", strerror (errno));
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+client_print_reply (blctl_t* ctl __attribute__ ((unused)), int status,
+                    char const* text, void* data __attribute__ ((unused)))
+{
+  if (status < 0)
+    eprintf ("%s", text);
+  else if (*text)
+    printf ("%s\n", text);
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
 client_execute (client_t* client)
 {
-  int sock, size;
-  message_t result = MESSAGE_INIT;
-  bool_t retval = false;
+  bool_t retval = true;
+  long long start;
+  blctl_t* ctl;
+  int i;
 
   context_spw_init ((context_t*) client);
 
@@ -133,50 +345,38 @@ client_execute (client_t* client)
     case FIELD_STOP:
     case FIELD_RESTART:
       return client_execute_stop_restart (client);
+    case FIELD_STATUS:
+      return client_execute_status (client);
+    case FIELD_WATCH:
+      return client_execute_watch (client);
     default:
       break;
     }
 
-  size = sizeof (client->msg);
-  sock = fs_open_socket (client->socketname, (sock_func_t) connect);
+  if (client->ring)
+    return client_execute_ring (client);
+  else if (client->no_wait)
+    return client_execute_dgram (client);
 
-  if (sock == -1 || write (sock, &client->msg, size) == -1)
-    eprintf ("%s", strerror (errno));
-  else
+  memcpy (client->msg.device, client->device, sizeof (client->device));
+  client->msg.wait = client->wait;
+
+  if (!(ctl = blctl_open (client->socketname)))
     {
-      do
-        {
-          switch (read (sock, &result, sizeof (result)))
-            {
-            case -1:
-              eprintf ("%s", strerror (errno));
-              break;
-
-            default:
-              retval = true;
-
-              switch (result.type)
-                {
-                case TYPE_INT:
-                  printf ("%i\n", result.v_int);
-                  break;
-
-                case TYPE_STRING:
-                  printf ("%s\n", result.v_str);
-                  break;
-
-                case TYPE_NONE:
-                  break;
-                case TYPE_ERROR:
-                  eprintf ("%s", result.v_str);
-                  retval = false;
-                }
-            }
-        }
-      while (retval && result.read_more);
+      eprintf ("%s", strerror (errno));
+      return false;
     }
 
-  close (sock);
+  start = latency_now ();
+
+  // With --repeat the command is sent again over the same connection.
+  for (i = 0; i < MAX (client->repeat, 1) && retval; i++)
+    retval = (blctl_send (ctl, &client->msg, client_print_reply, null) == 0);
+
+  if (retval && client->repeat > 1)
+    print_rate ("commands", client->repeat, latency_now () - start);
+
+  blctl_close (ctl);
 
   if (retval)
     printf ("Done\n");
@@ -197,6 +397,18 @@ set_message (client_t* ctx, message_t const* msg)
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+static bool_t
+set_sleep (client_t* ctx, message_t const* msg)
+{
+  // The sleep hooks are called as 'pre suspend' or 'post hibernate', the
+  // word after the first one only tells the kind of the sleep.
+  if (ctx->msg.field == FIELD_SLEEP || ctx->msg.field == FIELD_WAKE)
+    return true;
+
+  return set_message (ctx, msg);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
 static void
 client_clear (client_t* self)
 {
@@ -224,12 +436,69 @@ set_sockname (client_t* self, message_t const* msg)
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 bool_t
+set_repeat (client_t* self, message_t const* msg)
+{
+  self->repeat = msg->v_int;
+
+  return (msg->v_int > 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+set_ring (client_t* self, message_t const* msg __attribute__ ((unused)))
+{
+  self->ring = true;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+set_wait (client_t* self, message_t const* msg __attribute__ ((unused)))
+{
+  self->wait = true;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+set_no_wait (client_t* self, message_t const* msg __attribute__ ((unused)))
+{
+  self->no_wait = true;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+set_granularity (client_t* self, message_t const* msg)
+{
+  self->granularity = msg->v_int;
+
+  return (msg->v_int >= 0 && msg->v_int <= 100);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
 set_workdir (client_t* self, message_t const* msg)
 {
   return SETSTR (self->workdir, msg->v_str);
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+bool_t
+set_device (client_t* self, message_t const* msg)
+{
+  if (strlen (msg->v_str) >= sizeof (self->device))
+    return false;
+
+  strcpy (self->device, msg->v_str);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
 void
 client_init (context_t* ctx)
 {
@@ -237,20 +506,36 @@ client_init (context_t* ctx)
     return;
 
   memset (ctx, 0, sizeof (client_t));
+  ((client_t*) ctx)->granularity = -1;
 
   context_bind (ctx, INC, set_message);
   context_bind (ctx, DEC, set_message);
   context_bind (ctx, ON, set_message);
   context_bind (ctx, OFF, set_message);
   context_bind (ctx, SWITCH, set_message);
+  context_bind (ctx, SET, set_message);
   context_bind (ctx, STOP, set_message);
   context_bind (ctx, RESTART, set_message);
   context_bind (ctx, SAVED, set_message);
   context_bind (ctx, LIST, set_message);
+  context_bind (ctx, STATS, set_message);
+  context_bind (ctx, CALIBRATE, set_message);
+  context_bind (ctx, STATUS, set_message);
+  context_bind (ctx, REPEAT, set_repeat);
+  context_bind (ctx, RING, set_ring);
+  context_bind (ctx, WATCH, set_message);
+  context_bind (ctx, GRANULARITY, set_granularity);
+  context_bind (ctx, WAIT, set_wait);
+  context_bind (ctx, NO_WAIT, set_no_wait);
+  context_bind (ctx, SLEEP, set_sleep);
+  context_bind (ctx, WAKE, set_sleep);
   context_bind (ctx, MINIMAL, set_message);
   context_bind (ctx, NUM_LEVELS, set_message);
   context_bind (ctx, TRANSITION, set_message);
+  context_bind (ctx, LINKED, set_message);
+  context_bind (ctx, FADE_BLANK, set_message);
   context_bind (ctx, DEVNAME, set_message);
+  context_bind (ctx, DEVICE, set_device);
   context_bind (ctx, PIDFILE, set_pidfile);
   context_bind (ctx, SOCKNAME, set_sockname);
   context_bind (ctx, WORKDIR, set_workdir);
@@ -11,4 +11,11 @@
 
 void client_init (context_t* ctx);
 
+// The commands of the library for the messages parsed already, see
+// backlightctl.c. blctl_send() waits for the answer.
+int blctl_request (blctl_t* ctl, message_t const* msg, blctl_reply_func_t func,
+                   void* data);
+int blctl_send (blctl_t* ctl, message_t const* msg, blctl_reply_func_t func,
+                void* data);
+
 #endif /* SRC_CLIENT_H_ */
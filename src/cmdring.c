@@ -0,0 +1,165 @@
+/*
+ * cmdring.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include "includes.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define MASK (CMDRING_SIZE - 1)
+#define load(x, o) atomic_load_explicit (&(x), memory_order_##o)
+#define store(x, v, o) atomic_store_explicit (&(x), (v), memory_order_##o)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+cmdring_t*
+cmdring_create (int* fd)
+{
+  cmdring_t* ring;
+  unsigned i;
+  int rc;
+
+  // The ring is passed to the clients only by its descriptor.
+  if ((*fd = memfd_create ("backlight-commands", MFD_CLOEXEC)) < 0)
+    return null;
+
+  if (ftruncate (*fd, sizeof (*ring)) < 0
+      || (ring = mmap (null, sizeof (*ring), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, *fd, 0))
+             == MAP_FAILED)
+    {
+      rc = errno;
+      set_fd (*fd, -1);
+      errno = rc;
+      return null;
+    }
+
+  ring->magic = CMDRING_MAGIC;
+  ring->size = sizeof (*ring);
+  atomic_init (&ring->head, 0);
+  atomic_init (&ring->tail, 0);
+  ring->stalled_at = -1;
+
+  for (i = 0; i < CMDRING_SIZE; i++)
+    atomic_init (&ring->slots[i].seq, i);
+
+  return ring;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+cmdring_t*
+cmdring_attach (int fd)
+{
+  cmdring_t* ring;
+
+  ring = mmap (null, sizeof (*ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (ring == MAP_FAILED)
+    return null;
+  else if (ring->magic != CMDRING_MAGIC || ring->size != sizeof (*ring))
+    {
+      munmap (ring, sizeof (*ring));
+      errno = EPROTO;
+      return null;
+    }
+
+  return ring;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+cmdring_destroy (cmdring_t* ring)
+{
+  if (ring)
+    munmap (ring, sizeof (*ring));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+cmdring_push (cmdring_t* ring, cmdring_cmd_t const* cmd)
+{
+  cmdring_slot_t* slot;
+  unsigned pos = load (ring->head, relaxed);
+  int dif;
+
+  for (;;)
+    {
+      slot = ring->slots + (pos & MASK);
+      dif = (int) (load (slot->seq, acquire) - pos);
+
+      // A failed exchange reloads 'pos' with the position taken by
+      // another producer.
+      if (dif == 0
+          && atomic_compare_exchange_weak_explicit (&ring->head, &pos, pos + 1,
+                                                    memory_order_relaxed,
+                                                    memory_order_relaxed))
+        break;
+      else if (dif < 0)
+        return false;
+      else if (dif > 0)
+        pos = load (ring->head, relaxed);
+    }
+
+  slot->cmd = *cmd;
+  store (slot->seq, pos + 1, release);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+cmdring_pop (cmdring_t* ring, cmdring_cmd_t* cmd)
+{
+  unsigned pos = load (ring->tail, relaxed);
+  cmdring_slot_t* slot = ring->slots + (pos & MASK);
+
+  while (load (slot->seq, acquire) != pos + 1)
+    {
+      // Nothing was claimed, or the claim is young enough to be written.
+      if ((int) (load (ring->head, relaxed) - pos) <= 0)
+        return false;
+      else if (ring->stalled_at < 0 || ring->stalled != pos)
+        {
+          ring->stalled = pos;
+          ring->stalled_at = latency_now ();
+          return false;
+        }
+      else if (latency_now () - ring->stalled_at < CMDRING_STALL)
+        return false;
+
+      // Its producer is gone, the slot is freed for the next round.
+      ring->stalled_at = -1;
+      store (ring->tail, pos + 1, relaxed);
+      store (slot->seq, pos + CMDRING_SIZE, release);
+      slot = ring->slots + (++pos & MASK);
+    }
+
+  *cmd = slot->cmd;
+  ring->stalled_at = -1;
+  store (ring->tail, pos + 1, relaxed);
+  store (slot->seq, pos + CMDRING_SIZE, release);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+long long
+cmdring_deadline (cmdring_t const* ring)
+{
+  // The time the stalled slot is skipped at, the consumer polls again then.
+  return (ring->stalled_at < 0) ? -1 : ring->stalled_at + CMDRING_STALL;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#undef MASK
+#undef load
+#undef store
@@ -0,0 +1,75 @@
+/*
+ * cmdring.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_CMDRING_H_
+#define SRC_CMDRING_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdatomic.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define CMDRING_MAGIC 0x424c4352
+#define CMDRING_SIZE 256
+// A slot claimed and not written within this many nanoseconds belonged
+// to a client that died, it is skipped. A client gives up on a ring that
+// stays full as long.
+#define CMDRING_STALL (500 * 1000000LL)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A command written by a client. 'stamp' is the monotonic time it was
+// issued at, the server measures its delay from it.
+typedef struct cmdring_cmd_t
+{
+  long long stamp;
+  int field;
+  int value;
+  char device[DEVSIZE];
+} cmdring_cmd_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct cmdring_slot_t
+{
+  atomic_uint seq;
+  cmdring_cmd_t cmd;
+} cmdring_slot_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A bounded queue in shared memory written by any number of clients and
+// read by the server. A slot is free for the producer that has claimed
+// position 'pos' of 'head' when its 'seq' equals 'pos', and it is ready
+// for the consumer when 'seq' is 'pos + 1'; neither side ever waits for
+// the other. 'stalled' is the position the consumer found claimed and
+// not written since 'stalled_at', -1 when there is none; only the
+// consumer touches them.
+//
+// Every client that maps the ring can write all of it, so it is handed
+// out only to root and the owner of the server (see server_is_private).
+// The rest go through the socket. What the server takes from the ring is
+// checked like any other command; a client that dies in the middle of a
+// push costs the commands behind it a CMDRING_STALL delay.
+typedef struct cmdring_t
+{
+  int magic;
+  int size;
+  _Alignas (64) atomic_uint head;
+  _Alignas (64) atomic_uint tail;
+  unsigned stalled;
+  long long stalled_at;
+  _Alignas (64) cmdring_slot_t slots[CMDRING_SIZE];
+} cmdring_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+cmdring_t* cmdring_create (int* fd);
+cmdring_t* cmdring_attach (int fd);
+void cmdring_destroy (cmdring_t* ring);
+bool_t cmdring_push (cmdring_t* ring, cmdring_cmd_t const* cmd);
+bool_t cmdring_pop (cmdring_t* ring, cmdring_cmd_t* cmd);
+long long cmdring_deadline (cmdring_t const* ring);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_CMDRING_H_ */
@@ -34,9 +34,11 @@ context_spw_init (context_t* self)
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static option_t const*
-find_option (option_t const* options, char const* name)
+find_option (char const* name)
 {
-  if (!name || !*name || !options)
+  option_t const* options = statics_options;
+
+  if (!name || !*name)
     return null;
 
   int so = 0;
@@ -52,11 +54,14 @@ find_option (option_t const* options, char const* name)
   else
     lo = name;
 
+  // The options are those of statics_options, the long names are looked up
+  // in its hash table and the few short ones are searched.
+  if (lo)
+    return opthash_find (lo, strlen (lo));
+
   while (options->field != FIELD_NONE)
     {
-      if (options->short_name && so && options->short_name == so)
-        return options;
-      else if (options->long_name && lo && !strcmp (options->long_name, lo))
+      if (options->short_name && options->short_name == so)
         return options;
 
       options++;
@@ -101,7 +106,7 @@ context_create (int argc, char** argv)
       return null;
 
     default:
-      opt = find_option (statics_options, argv[1]);
+      opt = find_option (argv[1]);
     }
 
   if (opt == null)
@@ -122,6 +127,12 @@ context_create (int argc, char** argv)
       ctx = context_allocate ();
       server_init (ctx);
       context_bind (ctx, START, dummy_server_start);
+      ctx->data.server.argv = argv;
+      break;
+
+    case FIELD_RESTORE:
+      ctx = context_allocate ();
+      server_init (ctx);
       break;
 
     case FIELD_NONE:
@@ -210,7 +221,7 @@ context_configure (context_t* ctx, int argc, char** argv)
 
   while (args < args_end && rc > 0)
     {
-      opt = find_option (statics_options, *args);
+      opt = find_option (*args);
 
       if (opt)
         {
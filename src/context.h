@@ -29,6 +29,12 @@ struct context_t
         char* pidfile;
         char* workdir;
         message_t msg;
+        char device[DEVSIZE];
+        int repeat;
+        bool_t ring;
+        bool_t wait;
+        bool_t no_wait;
+        int granularity;
       } client;
 
       struct server_t
@@ -37,22 +43,52 @@ struct context_t
         char* pidfile;
         char* workdir;
         char* config;
+        char** argv;
         bool_t daemon;
+        bool_t restart;
+        int requester;
+        int lock;
+        handover_t* handover;
+        statpage_t* page;
+        cmdring_t* ring;
+        int ring_fd;
+        int ring_wake;
+        bool_t activated;
+        bool_t oneshot;
+        int idle_exit;
         int socket;
-        int timeout;
+        int dgram;
+        int uevent;
         int transition;
         int minimal;
         int num_levels;
-        int level_size;
-        int level;
+        bool_t linked;
+        bool_t fade_blank;
 
-        struct
-        {
-          int max;
-          int get;
-          int set;
-          char* name;
-        } dev;
+        server_device_t devs[SCHED_MAX_DEVICES];
+
+        config_t conf;
+        bool_t conf_loaded;
+        bool_t dirty;
+        long long flush_at;
+
+        inventory_t inventory;
+        sched_t sched;
+        watch_t watch;
+        server_waiter_t waiters[SERVER_MAX_WAITERS];
+        int n_waiters;
+        admission_t admission;
+        notify_t notify;
+        latency_t handle;
+        latency_t first;
+        latency_t ring_delay;
+        latency_t receive;
+        latency_t restore;
+        latency_t resume;
+        long long woke_at;
+        int waking;
+        long long started_at;
+        long long active_at;
       } server;
     } data;
   };
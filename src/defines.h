@@ -17,6 +17,11 @@
 //------------------------------------------------------------------------------
 #define BUFFER_SIZE 1024
 #define STRSIZE 256
+#define DEVSIZE 64
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The datagram socket of the server is the stream one with this suffix.
+#define DGRAM_SUFFIX ".dgram"
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 #define ckfree(x)                                                              \
@@ -77,6 +82,8 @@
   FN (PIDFILE, STRING)                                                         \
   FN (CONFIG, STRING)                                                          \
   FN (DAEMON, NONE)                                                            \
+  FN (RATE_LIMIT, INT)                                                         \
+  FN (IDLE_EXIT, INT)                                                          \
   FN (START, NONE)                                                             \
   FN (INC, NONE)                                                               \
   FN (DEC, NONE)                                                               \
@@ -88,10 +95,25 @@
   FN (MINIMAL, INT)                                                            \
   FN (NUM_LEVELS, INT)                                                         \
   FN (TRANSITION, INT)                                                         \
+  FN (LINKED, INT)                                                             \
+  FN (FADE_BLANK, INT)                                                         \
   FN (SAVED, NONE)                                                             \
   FN (DEVNAME, STRING)                                                         \
+  FN (DEVICE, STRING)                                                          \
   FN (LIST, NONE)                                                              \
-  FN (STUB, NONE)
+  FN (STATS, NONE)                                                             \
+  FN (RESTORE, NONE)                                                           \
+  FN (SLEEP, NONE)                                                             \
+  FN (WAKE, NONE)                                                              \
+  FN (CALIBRATE, NONE)                                                         \
+  FN (STATUS, NONE)                                                            \
+  FN (REPEAT, INT)                                                             \
+  FN (RING, NONE)                                                              \
+  FN (WATCH, NONE)                                                             \
+  FN (GRANULARITY, INT)                                                        \
+  FN (WAIT, NONE)                                                              \
+  FN (NO_WAIT, NONE)                                                           \
+  FN (SET, INT)
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 #define _seterrf(e, fmt, ...)                                                  \
@@ -108,7 +130,7 @@
 //------------------------------------------------------------------------------
 #define eprintf(fmt, ...)                                                      \
   __extension__({                                                              \
-    char __eprt_tmp[STRSIZE];                                                  \
+    char __eprt_tmp[STRSIZE * 2];                                              \
     seterrf (__eprt_tmp, fmt, __VA_ARGS__);                                    \
     fprintf (stderr, "%s\n", __eprt_tmp);                                      \
   })
@@ -0,0 +1,540 @@
+/*
+ * devio.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define SLOT_READ 1
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t uring_init (devio_t* io);
+static void uring_clear (devio_t* io);
+static bool_t uring_queue (devio_t* io, int slot, int set, int get);
+static bool_t uring_submit (devio_t* io);
+static int uring_reap (devio_t* io, devio_func_t func, void* data);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+devio_pread (void* data __attribute__ ((unused)), int fd, char* buf, int size)
+{
+  return pread (fd, buf, size, 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+devio_pwrite (void* data __attribute__ ((unused)), int fd, char const* buf,
+              int len)
+{
+  return pwrite (fd, buf, len, 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+parse_value (char const* buf, int len)
+{
+  char const* end = buf + len;
+  char const* p;
+  int val = 0;
+
+  for (p = buf; p < end && isdigit (*p); p++)
+    val = val * 10 + (*p - '0');
+
+  return (p > buf) ? val : -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+devio_init (devio_t* io, int n_slots)
+{
+  int i;
+
+  memset (io, 0, sizeof (*io));
+
+  io->fd = -1;
+  io->n_slots = n_slots;
+  io->backend.read = devio_pread;
+  io->backend.write = devio_pwrite;
+  io->slots = calloc (n_slots, sizeof (*io->slots));
+
+  if (!io->slots)
+    return false;
+
+  for (i = 0; i < n_slots; i++)
+    {
+      io->slots[i].wv.iov_base = io->slots[i].wbuf;
+      io->slots[i].rv.iov_base = io->slots[i].rbuf;
+      io->slots[i].rv.iov_len = sizeof (io->slots[i].rbuf);
+    }
+
+  // Falling back to the synchronous calls is not an error, the kernel
+  // may be too old or io_uring may be disabled by a sysctl or seccomp.
+  if (!uring_init (io))
+    uring_clear (io);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+devio_clear (devio_t* io)
+{
+  if (!io)
+    return;
+
+  uring_clear (io);
+  ckfree (io->slots);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+devio_set_backend (devio_t* io, devio_backend_t const* backend)
+{
+  // The devices of another backend are not files, io_uring can not reach
+  // them. Set before the first request.
+  uring_clear (io);
+  io->backend = *backend;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+devio_write (devio_t* io, int slot, int set, int get, int value)
+{
+  devio_slot_t* s = io->slots + slot;
+  int len;
+
+  if (s->busy)
+    return false;
+
+  len = snprintf (s->wbuf, sizeof (s->wbuf), "%d", value);
+  s->wv.iov_len = len;
+  s->busy = true;
+
+  if (io->uring)
+    return uring_queue (io, slot, set, get);
+
+  s->done = true;
+  s->value = -1;
+
+  if (io->backend.write (io->backend.data, set, s->wbuf, len) == len)
+    {
+      len = io->backend.read (io->backend.data, get, s->rbuf,
+                              sizeof (s->rbuf));
+      s->value = parse_value (s->rbuf, len);
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+devio_read (devio_t* io, int slot, int get)
+{
+  devio_slot_t* s = io->slots + slot;
+  int len;
+
+  if (s->busy)
+    return false;
+
+  s->busy = true;
+
+  if (io->uring)
+    return uring_queue (io, slot, -1, get);
+
+  len = io->backend.read (io->backend.data, get, s->rbuf, sizeof (s->rbuf));
+  s->value = parse_value (s->rbuf, len);
+  s->done = true;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+devio_get (devio_t* io, int fd)
+{
+  char buf[16];
+
+  // A plain read outside of the slots, for the values nobody waits for.
+  return parse_value (buf, io->backend.read (io->backend.data, fd, buf,
+                                             sizeof (buf)));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+devio_set (devio_t* io, int fd, int value)
+{
+  char buf[16];
+  int len;
+
+  // The rare writes, like the power or the samples of a calibration, are
+  // not worth a slot.
+  len = snprintf (buf, sizeof (buf), "%d", value);
+
+  return (io->backend.write (io->backend.data, fd, buf, len) == len);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+devio_probe (devio_t* io, int set, int get, int* write_us, int* read_us)
+{
+  long long start, write_cost = 0, read_cost = 0;
+  int i, value;
+
+  // The worst of three rounds. The setting is read from 'set' and written
+  // back as it is, the value reported by 'get' may be a rounded one, so
+  // the probe does not move the device. Nothing is written when either
+  // of them can not be read.
+  for (i = 0; i < 3; i++)
+    {
+      start = latency_now ();
+      value = devio_get (io, get);
+      read_cost = MAX (read_cost, latency_now () - start);
+
+      if (value < 0 || (value = devio_get (io, set)) < 0)
+        return false;
+
+      start = latency_now ();
+
+      if (!devio_set (io, set, value))
+        return false;
+
+      write_cost = MAX (write_cost, latency_now () - start);
+    }
+
+  *write_us = write_cost / 1000;
+  *read_us = read_cost / 1000;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+devio_submit (devio_t* io)
+{
+  if (io->uring)
+    return uring_submit (io);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+devio_reap (devio_t* io, devio_func_t func, void* data)
+{
+  devio_slot_t* s;
+  int count = 0;
+
+  if (io->uring)
+    return uring_reap (io, func, data);
+
+  for (s = io->slots; s < io->slots + io->n_slots; s++)
+    {
+      if (!s->done)
+        continue;
+
+      s->done = false;
+      s->busy = false;
+      func (data, s - io->slots, s->value);
+      count++;
+    }
+
+  return count;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifdef HAVE_IO_URING
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+struct devio_uring_t
+{
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_mask;
+  unsigned* sq_array;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned* cq_mask;
+  struct io_uring_sqe* sqes;
+  struct io_uring_cqe* cqes;
+  void* sq_ptr;
+  void* cq_ptr;
+  size_t sq_size;
+  size_t cq_size;
+  size_t sqes_size;
+  unsigned entries;
+  unsigned tail;
+  unsigned queued;
+};
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define load_acquire(p) __atomic_load_n ((p), __ATOMIC_ACQUIRE)
+#define store_release(p, v) __atomic_store_n ((p), (v), __ATOMIC_RELEASE)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void*
+uring_mmap (int fd, size_t size, off_t offset)
+{
+  void* ptr = mmap (null, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, offset);
+
+  return (ptr == MAP_FAILED) ? null : ptr;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+uring_init (devio_t* io)
+{
+  struct io_uring_params p;
+  struct devio_uring_t* u;
+  char* sq;
+  char* cq;
+
+  if (!(u = io->uring = calloc (1, sizeof (*u))))
+    return false;
+
+  memset (&p, 0, sizeof (p));
+
+  // Every slot may have a write and a read in flight.
+  io->fd = syscall (__NR_io_uring_setup, MAX (io->n_slots * 2, 8), &p);
+
+  if (io->fd < 0)
+    return false;
+
+  u->entries = p.sq_entries;
+  u->sq_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+  u->cq_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  u->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    u->sq_size = u->cq_size = MAX (u->sq_size, u->cq_size);
+
+  u->sq_ptr = uring_mmap (io->fd, u->sq_size, IORING_OFF_SQ_RING);
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    u->cq_ptr = u->sq_ptr;
+  else
+    u->cq_ptr = uring_mmap (io->fd, u->cq_size, IORING_OFF_CQ_RING);
+
+  u->sqes = uring_mmap (io->fd, u->sqes_size, IORING_OFF_SQES);
+
+  if (!u->sq_ptr || !u->cq_ptr || !u->sqes)
+    return false;
+
+  sq = u->sq_ptr;
+  cq = u->cq_ptr;
+  u->sq_head = (unsigned*) (sq + p.sq_off.head);
+  u->sq_tail = (unsigned*) (sq + p.sq_off.tail);
+  u->sq_mask = (unsigned*) (sq + p.sq_off.ring_mask);
+  u->sq_array = (unsigned*) (sq + p.sq_off.array);
+  u->cq_head = (unsigned*) (cq + p.cq_off.head);
+  u->cq_tail = (unsigned*) (cq + p.cq_off.tail);
+  u->cq_mask = (unsigned*) (cq + p.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe*) (cq + p.cq_off.cqes);
+  u->tail = *u->sq_tail;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+uring_clear (devio_t* io)
+{
+  struct devio_uring_t* u = io->uring;
+
+  if (u)
+    {
+      if (u->sqes)
+        munmap (u->sqes, u->sqes_size);
+      if (u->cq_ptr && u->cq_ptr != u->sq_ptr)
+        munmap (u->cq_ptr, u->cq_size);
+      if (u->sq_ptr)
+        munmap (u->sq_ptr, u->sq_size);
+    }
+
+  ckfree (io->uring);
+  set_fd (io->fd, -1);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static struct io_uring_sqe*
+uring_get_sqe (struct devio_uring_t* u)
+{
+  struct io_uring_sqe* sqe;
+  unsigned index;
+
+  if (u->tail - load_acquire (u->sq_head) >= u->entries)
+    return null;
+
+  index = u->tail & *u->sq_mask;
+  sqe = u->sqes + index;
+  u->sq_array[index] = index;
+  u->tail++;
+  u->queued++;
+
+  memset (sqe, 0, sizeof (*sqe));
+
+  return sqe;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+uring_queue (devio_t* io, int slot, int set, int get)
+{
+  struct devio_uring_t* u = io->uring;
+  struct io_uring_sqe* sqe;
+  devio_slot_t* s = io->slots + slot;
+
+  // The pair is only queued when both entries fit, a half-queued
+  // chain would write without verification.
+  if (u->entries - (u->tail - load_acquire (u->sq_head)) < 2)
+    {
+      s->busy = false;
+      return false;
+    }
+
+  if (set >= 0)
+    {
+      sqe = uring_get_sqe (u);
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->flags = IOSQE_IO_LINK;
+      sqe->fd = set;
+      sqe->addr = (unsigned long) &s->wv;
+      sqe->len = 1;
+      sqe->user_data = slot << 1;
+    }
+
+  sqe = uring_get_sqe (u);
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = get;
+  sqe->addr = (unsigned long) &s->rv;
+  sqe->len = 1;
+  sqe->user_data = (slot << 1) | SLOT_READ;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+uring_submit (devio_t* io)
+{
+  struct devio_uring_t* u = io->uring;
+  int rc;
+
+  if (!u->queued)
+    return true;
+
+  store_release (u->sq_tail, u->tail);
+
+  while ((rc = syscall (__NR_io_uring_enter, io->fd, u->queued, 0, 0, null, 0))
+         < 0
+         && errno == EINTR)
+    ;
+
+  if (rc < 0)
+    {
+      eprintf ("%s", strerror (errno));
+      return false;
+    }
+
+  u->queued -= MIN ((unsigned) rc, u->queued);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+uring_reap (devio_t* io, devio_func_t func, void* data)
+{
+  struct devio_uring_t* u = io->uring;
+  struct io_uring_cqe* cqe;
+  devio_slot_t* s;
+  unsigned head = *u->cq_head;
+  int count = 0;
+  int slot;
+
+  while (head != load_acquire (u->cq_tail))
+    {
+      cqe = u->cqes + (head & *u->cq_mask);
+      slot = cqe->user_data >> 1;
+      head++;
+
+      // A failed write cancels the linked read, so every request
+      // is reported exactly once, by its read.
+      if (!(cqe->user_data & SLOT_READ) || slot >= io->n_slots)
+        continue;
+
+      s = io->slots + slot;
+      s->value = (cqe->res > 0) ? parse_value (s->rbuf, cqe->res) : -1;
+      s->busy = false;
+      func (data, slot, s->value);
+      count++;
+    }
+
+  store_release (u->cq_head, head);
+
+  return count;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#else
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+uring_init (devio_t* io __attribute__ ((unused)))
+{
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+uring_clear (devio_t* io __attribute__ ((unused)))
+{
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+uring_queue (devio_t* io __attribute__ ((unused)),
+             int slot __attribute__ ((unused)),
+             int set __attribute__ ((unused)),
+             int get __attribute__ ((unused)))
+{
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+uring_submit (devio_t* io __attribute__ ((unused)))
+{
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+uring_reap (devio_t* io __attribute__ ((unused)),
+            devio_func_t func __attribute__ ((unused)),
+            void* data __attribute__ ((unused)))
+{
+  return 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
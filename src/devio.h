@@ -0,0 +1,77 @@
+/*
+ * devio.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_DEVIO_H_
+#define SRC_DEVIO_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <sys/uio.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Called for each finished request with the value that was read back
+// from the device, or -1 when the request failed.
+typedef void (*devio_func_t) (void* data, int slot, int value);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The calls that reach the devices, with the meaning of pread() and
+// pwrite() at the offset 0. The default ones are those, a program that
+// embeds the scheduler may put its own devices behind them.
+typedef struct devio_backend_t
+{
+  int (*read) (void* data, int fd, char* buf, int size);
+  int (*write) (void* data, int fd, char const* buf, int len);
+  void* data;
+} devio_backend_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct devio_slot_t
+{
+  int value;
+  bool_t busy;
+  bool_t done;
+  char wbuf[16];
+  char rbuf[16];
+  struct iovec wv;
+  struct iovec rv;
+} devio_slot_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Device I/O backend. With io_uring every write is submitted together
+// with its verification read as a linked pair, all of them in a single
+// io_uring_enter() per tick, and 'fd' becomes readable when completions
+// are ready. Without it the same calls are performed synchronously
+// through 'backend', which is the only way with a backend of its own.
+typedef struct devio_t
+{
+  int fd;
+  int n_slots;
+  devio_slot_t* slots;
+  struct devio_uring_t* uring;
+  devio_backend_t backend;
+} devio_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t devio_init (devio_t* io, int n_slots);
+void devio_clear (devio_t* io);
+void devio_set_backend (devio_t* io, devio_backend_t const* backend);
+bool_t devio_write (devio_t* io, int slot, int set, int get, int value);
+bool_t devio_read (devio_t* io, int slot, int get);
+int devio_get (devio_t* io, int fd);
+bool_t devio_set (devio_t* io, int fd, int value);
+bool_t devio_probe (devio_t* io, int set, int get, int* write_us,
+                    int* read_us);
+bool_t devio_submit (devio_t* io);
+int devio_reap (devio_t* io, devio_func_t func, void* data);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define devio_fd(io) ((io)->fd)
+#define devio_busy(io, slot) ((io)->slots[(slot)].busy)
+#define devio_is_async(io) ((io)->uring != null)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_DEVIO_H_ */
@@ -23,9 +23,11 @@ typedef enum default_t
   DEFAULT_SOCKET,
   DEFAULT_PIDFILE,
   DEFAULT_CONFIG,
+  DEFAULT_STATUS,
   DEFAULT_TRANSITION,
   DEFAULT_NUM_LEVELS,
   DEFAULT_MINIMAL,
+  DEFAULT_RATE_LIMIT,
   DEFAULT_NONE
 } default_t;
 
@@ -12,6 +12,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,6 +23,7 @@
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 #define PATH_SEPARATOR '/'
+#define FS_MAX_FDS 8
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 typedef struct string_t
@@ -278,26 +280,44 @@ fs_stringf (char const* format, ...)
 int
 fs_open_socket (char const* path, sock_func_t func)
 {
-  int sock, rc;
+  return fs_open_socket_type (path, SOCK_STREAM, func);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+fs_open_socket_type (char const* path, int type, sock_func_t func)
+{
+  int sock, rc, len;
   struct sockaddr_un addr;
+  socklen_t addrlen = sizeof (addr);
   typedef int (*real_sock_func_t) (int, struct sockaddr const*, socklen_t);
   real_sock_func_t invoke = (real_sock_func_t) func;
 
-  if (!path || !*path || !func)
+  if (!path || !*path || !func
+      || (len = strlen (path)) >= (int) sizeof (addr.sun_path))
     {
       errno = EADDRNOTAVAIL;
       return -1;
     }
 
-  sock = socket (AF_UNIX, SOCK_STREAM, 0);
+  sock = socket (AF_UNIX, type | SOCK_CLOEXEC, 0);
 
   switch (sock)
     {
     default:
+      memset (&addr, 0, sizeof (addr));
       addr.sun_family = AF_UNIX;
       strcpy (addr.sun_path, path);
 
-      if (invoke (sock, (struct sockaddr*) &addr, sizeof (addr)) == 0)
+      // The abstract name is the bytes after the leading zero, the length
+      // of the address tells where it ends.
+      if (fs_socket_is_abstract (path))
+        {
+          addr.sun_path[0] = 0;
+          addrlen = offsetof (struct sockaddr_un, sun_path) + len;
+        }
+
+      if (invoke (sock, (struct sockaddr*) &addr, addrlen) == 0)
         break;
       /* no break */
     case -1:
@@ -310,3 +330,76 @@ fs_open_socket (char const* path, sock_func_t func)
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+int
+fs_send_fds (int sock, void const* data, int size, int const* fds, int n)
+{
+  char buf[CMSG_SPACE (sizeof (int) * FS_MAX_FDS)];
+  struct iovec iov = { (void*) data, size };
+  struct msghdr msg = { 0 };
+  struct cmsghdr* cmsg;
+
+  if (n < 0 || n > FS_MAX_FDS)
+    {
+      errno = EINVAL;
+      return -1;
+    }
+
+  memset (buf, 0, sizeof (buf));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = buf;
+  msg.msg_controllen = CMSG_SPACE (sizeof (int) * n);
+
+  cmsg = CMSG_FIRSTHDR (&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN (sizeof (int) * n);
+  memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * n);
+
+  return sendmsg (sock, &msg, MSG_NOSIGNAL);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+fs_recv_fds (int sock, void* data, int size, int* fds, int n)
+{
+  char buf[CMSG_SPACE (sizeof (int) * FS_MAX_FDS)];
+  struct iovec iov = { data, size };
+  struct msghdr msg = { 0 };
+  struct cmsghdr* cmsg;
+  int i, got, rc, fd;
+
+  for (i = 0; i < n; i++)
+    fds[i] = -1;
+
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = buf;
+  msg.msg_controllen = sizeof (buf);
+
+  if ((rc = recvmsg (sock, &msg, MSG_CMSG_CLOEXEC)) < 0)
+    return rc;
+
+  for (cmsg = CMSG_FIRSTHDR (&msg); cmsg; cmsg = CMSG_NXTHDR (&msg, cmsg))
+    {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+
+      got = (cmsg->cmsg_len - CMSG_LEN (0)) / sizeof (int);
+
+      // The descriptors nobody asked for are not leaked.
+      for (i = 0; i < got; i++)
+        {
+          memcpy (&fd, CMSG_DATA (cmsg) + i * sizeof (int), sizeof (fd));
+
+          if (i < n)
+            fds[i] = fd;
+          else
+            close (fd);
+        }
+    }
+
+  return rc;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
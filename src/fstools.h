@@ -36,7 +36,19 @@ char* fs_stringf (char const* format, ...);
 typedef void (*sock_func_t) (void);
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+// A name starting with '@' is taken from the abstract namespace: there is
+// no file to chmod or to unlink, and nothing is left behind by a crash.
 int fs_open_socket (char const* path, sock_func_t func);
+int fs_open_socket_type (char const* path, int type, sock_func_t func);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define fs_socket_is_abstract(path) ((path) && *(path) == '@')
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A message with the descriptors attached to it as SCM_RIGHTS. The
+// received ones are close-on-exec, those that did not come are -1.
+int fs_send_fds (int sock, void const* data, int size, int const* fds, int n);
+int fs_recv_fds (int sock, void* data, int size, int* fds, int n);
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 #endif /* SRC_FSTOOLS_H_ */
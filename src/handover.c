@@ -0,0 +1,131 @@
+/*
+ * handover.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include "includes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define HANDOVER_HEAD_SIZE offsetof (handover_t, devs)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+handover_set_cloexec (handover_t const* self, bool_t cloexec)
+{
+  int flag = cloexec ? FD_CLOEXEC : 0;
+  int i;
+
+  if (self->socket >= 0)
+    fcntl (self->socket, F_SETFD, flag);
+
+  if (self->lock >= 0)
+    fcntl (self->lock, F_SETFD, flag);
+
+  if (self->dgram >= 0)
+    fcntl (self->dgram, F_SETFD, flag);
+
+  for (i = 0; i < self->n_clients; i++)
+    fcntl (self->clients[i].fd, F_SETFD, flag);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+handover_pass (handover_t* self)
+{
+  char env[16];
+  int fd, rc;
+
+  self->magic = HANDOVER_MAGIC;
+  self->size = sizeof (*self);
+
+  // The memfd itself has to survive the exec() too.
+  if ((fd = memfd_create ("backlight-handover", 0)) < 0)
+    return false;
+
+  if (write (fd, self, sizeof (*self)) != sizeof (*self))
+    {
+      rc = errno;
+      set_fd (fd, -1);
+      errno = rc;
+      return false;
+    }
+
+  snprintf (env, sizeof (env), "%d", fd);
+  setenv (HANDOVER_ENV, env, true);
+  handover_set_cloexec (self, false);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+handover_cancel (handover_t* self)
+{
+  char const* env = getenv (HANDOVER_ENV);
+  int fd;
+
+  // The exec() has failed, the memfd left open for it is closed and the
+  // descriptors are not leaked to the children any more.
+  if (env && (fd = atoi (env)) >= 0)
+    set_fd (fd, -1);
+
+  unsetenv (HANDOVER_ENV);
+  handover_set_cloexec (self, true);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+handover_t*
+handover_take (void)
+{
+  char const* env = getenv (HANDOVER_ENV);
+  handover_t* self;
+  int fd, rc;
+
+  if (!env || (fd = atoi (env)) < 0)
+    return null;
+
+  unsetenv (HANDOVER_ENV);
+
+  if (!(self = calloc (1, sizeof (*self))))
+    {
+      set_fd (fd, -1);
+      return null;
+    }
+
+  rc = pread (fd, self, sizeof (*self), 0);
+  set_fd (fd, -1);
+
+  if (rc < (int) HANDOVER_HEAD_SIZE || self->magic != HANDOVER_MAGIC)
+    {
+      ckfree (self);
+      return null;
+    }
+
+  // An image of another version has left devices this one can not read,
+  // and its datagrams may not be the messages of this one.
+  if (self->size != sizeof (*self) || rc != sizeof (*self))
+    {
+      memset (self->devs, 0, sizeof (self->devs));
+      set_fd (self->dgram, -1);
+    }
+
+  self->n_clients = MAX (MIN (self->n_clients, HANDOVER_MAX_CLIENTS), 0);
+  handover_set_cloexec (self, true);
+
+  return self;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
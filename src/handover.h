@@ -0,0 +1,68 @@
+/*
+ * handover.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_HANDOVER_H_
+#define SRC_HANDOVER_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define HANDOVER_ENV "BACKLIGHT_HANDOVER"
+#define HANDOVER_MAGIC 0x424c4831
+#define HANDOVER_MAX_CLIENTS 256
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A connection passed to the next image with the credentials of its peer.
+// 'closing' marks the client that asked for the restart, it is answered
+// by closing the connection once the next image is ready.
+typedef struct handover_client_t
+{
+  int fd;
+  int uid;
+  int pid;
+  bool_t closing;
+} handover_client_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'remaining' is the time left of the transition to 'target' in
+// milliseconds, 0 when the device is at rest.
+typedef struct handover_device_t
+{
+  char name[DEVSIZE];
+  int level;
+  int target;
+  int remaining;
+  bool_t blanked;
+} handover_device_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The state a restarting server passes to its next image in a memfd. The
+// head up to 'devs' keeps its layout between the versions, so the
+// descriptors are taken over after an upgrade too; the devices are taken
+// only from an image of the same version, and the datagram socket of
+// another version is closed. The clients are as many as the poll set of
+// the server holds, none of them is left behind.
+typedef struct handover_t
+{
+  int magic;
+  int size;
+  int socket;
+  int lock;
+  int dgram;
+  bool_t activated;
+  int n_clients;
+  handover_client_t clients[HANDOVER_MAX_CLIENTS];
+
+  handover_device_t devs[SCHED_MAX_DEVICES];
+} handover_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t handover_pass (handover_t* self);
+void handover_cancel (handover_t* self);
+handover_t* handover_take (void);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_HANDOVER_H_ */
@@ -16,8 +16,25 @@
 #include "structs.h"
 #include "typedefs.h"
 #include "statics.h"
+#include "opthash.h"
+#include "message.h"
 #include "fstools.h"
+#include "ring.h"
+#include "latency.h"
+#include "devio.h"
+#include "transition.h"
+#include "levels.h"
+#include "scheduler.h"
+#include "admission.h"
+#include "inventory.h"
+#include "uevent.h"
+#include "notify.h"
+#include "handover.h"
+#include "statpage.h"
+#include "cmdring.h"
+#include "watch.h"
 #include "usage.h"
+#include "backlightctl.h"
 #include "client.h"
 #include "server.h"
 #include "context.h"
@@ -0,0 +1,373 @@
+/*
+ * inventory.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define _GNU_SOURCE
+#include "includes.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static char const* const type_names[] = { "unknown", "raw", "platform",
+                                          "firmware" };
+static char const* const scale_names[] = { "unknown", "linear",
+                                           "non-linear" };
+static char const* const class_dirs[] = { BACKLIGHT_DIR, LEDS_DIR };
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline char const*
+device_attr (device_class_t cls, char const* attr)
+{
+  // The LEDs do not report the value of the hardware separately, the
+  // value they were set to is what they show.
+  if (cls == DEVICE_CLASS_LED && strcmp (attr, "actual_brightness") == 0)
+    return "brightness";
+
+  return attr;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline char const*
+device_basename (char const* name)
+{
+  if (inventory_class (name) == DEVICE_CLASS_LED)
+    return name + sizeof (LEDS_PREFIX) - 1;
+
+  return name;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+class_fd (inventory_t* inv, device_class_t cls)
+{
+  if (inv->classes[cls] < 0)
+    inv->classes[cls] = open (class_dirs[cls],
+                              O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+  return inv->classes[cls];
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+read_attr (device_info_t const* info, char const* attr, char* dest, int size)
+{
+  int len = -1;
+  int fd;
+
+  attr = device_attr (info->cls, attr);
+
+  if ((fd = openat (info->dirfd, attr, O_RDONLY | O_CLOEXEC)) >= 0)
+    {
+      len = read (fd, dest, size - 1);
+      close (fd);
+    }
+
+  len = MAX (len, 0);
+
+  while (len > 0 && (dest[len - 1] == '\n' || dest[len - 1] == ' '))
+    len--;
+
+  dest[len] = 0;
+
+  return len;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+read_attr_int (device_info_t const* info, char const* attr)
+{
+  char buf[32];
+
+  if (read_attr (info, attr, buf, sizeof (buf)) <= 0)
+    return -1;
+
+  return atoi (buf);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+lookup (char const* const* names, int n_names, char const* value)
+{
+  int i;
+
+  for (i = 0; i < n_names; i++)
+    if (strcmp (names[i], value) == 0)
+      return i;
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+inventory_probe (device_info_t* info)
+{
+  char buf[32];
+
+  read_attr (info, "type", buf, sizeof (buf));
+  info->type = lookup (type_names, 4, buf);
+
+  read_attr (info, "scale", buf, sizeof (buf));
+  info->scale = lookup (scale_names, 3, buf);
+
+  info->max = MAX (read_attr_int (info, "max_brightness"), 0);
+  info->current = read_attr_int (info, "actual_brightness");
+  info->bl_power = read_attr_int (info, "bl_power");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+inventory_scan (inventory_t* inv, device_class_t cls, char const* prefix)
+{
+  char name[STRSIZE];
+  struct dirent* ent;
+  DIR* dir;
+  int fd;
+
+  // An O_PATH descriptor can not be listed, the directory is opened
+  // once more for reading.
+  if ((fd = class_fd (inv, cls)) < 0
+      || (fd = openat (fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+    return false;
+  else if ((dir = fdopendir (fd)) == null)
+    {
+      close (fd);
+      return false;
+    }
+
+  while ((ent = readdir (dir)) != null)
+    {
+      if (ent->d_name[0] == '.')
+        continue;
+
+      snprintf (name, sizeof (name), "%s%s", prefix, ent->d_name);
+      inventory_add (inv, name);
+    }
+
+  closedir (dir);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+inventory_build (inventory_t* inv)
+{
+  device_info_t* it;
+  bool_t found;
+
+  if (inv->valid)
+    return true;
+
+  for (it = inv->items; it < inv->items + inv->n_items; it++)
+    set_fd (it->dirfd, -1);
+
+  inv->n_items = 0;
+
+  found = inventory_scan (inv, DEVICE_CLASS_BACKLIGHT, "");
+  found = inventory_scan (inv, DEVICE_CLASS_LED, LEDS_PREFIX) || found;
+
+  return (inv->valid = found);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+inventory_init (inventory_t* inv)
+{
+  memset (inv, 0, sizeof (*inv));
+  inv->classes[DEVICE_CLASS_BACKLIGHT] = -1;
+  inv->classes[DEVICE_CLASS_LED] = -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+inventory_invalidate (inventory_t* inv)
+{
+  inv->valid = false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+inventory_clear (inventory_t* inv)
+{
+  device_info_t* it;
+
+  if (!inv)
+    return;
+
+  for (it = inv->items; it < inv->items + inv->n_items; it++)
+    set_fd (it->dirfd, -1);
+
+  set_fd (inv->classes[DEVICE_CLASS_BACKLIGHT], -1);
+  set_fd (inv->classes[DEVICE_CLASS_LED], -1);
+  ckfree (inv->items);
+  inv->n_items = 0;
+  inv->capacity = 0;
+  inv->valid = false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+device_info_t*
+inventory_find (inventory_t* inv, char const* name)
+{
+  device_info_t* it;
+
+  if (!name || !inventory_build (inv))
+    return null;
+
+  for (it = inv->items; it < inv->items + inv->n_items; it++)
+    if (strcmp (it->name, name) == 0)
+      return it;
+
+  return null;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+device_info_t*
+inventory_best (inventory_t* inv)
+{
+  device_info_t* it;
+  device_info_t* best = null;
+
+  if (!inventory_build (inv))
+    return null;
+
+  // The firmware interfaces know the panel best, the raw ones are only
+  // taken when nothing else is available. The larger range wins a tie.
+  for (it = inv->items; it < inv->items + inv->n_items; it++)
+    {
+      if (it->max <= 0 || it->cls != DEVICE_CLASS_BACKLIGHT)
+        continue;
+      else if (!best || it->type > best->type
+               || (it->type == best->type && it->max > best->max))
+        best = it;
+    }
+
+  return best;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+device_info_t*
+inventory_add (inventory_t* inv, char const* name)
+{
+  device_info_t* info;
+
+  if (!name || !*name || strlen (name) >= sizeof (info->name))
+    return null;
+
+  for (info = inv->items; info < inv->items + inv->n_items; info++)
+    if (strcmp (info->name, name) == 0)
+      break;
+
+  if (info == inv->items + inv->n_items)
+    {
+      if (inv->n_items == inv->capacity)
+        {
+          int capacity = MAX (inv->capacity * 2, 4);
+          void* items = realloc (inv->items, capacity * sizeof (*info));
+
+          if (!items)
+            return null;
+
+          inv->items = items;
+          inv->capacity = capacity;
+        }
+
+      info = inv->items + inv->n_items;
+      memset (info, 0, sizeof (*info));
+      strcpy (info->name, name);
+      info->cls = inventory_class (name);
+      info->dirfd = class_fd (inv, info->cls);
+
+      if (info->dirfd < 0
+          || (info->dirfd = openat (info->dirfd, device_basename (name),
+                                    O_PATH | O_DIRECTORY | O_CLOEXEC))
+                 < 0)
+        return null;
+
+      inv->n_items++;
+    }
+
+  inventory_probe (info);
+
+  return info;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+inventory_remove (inventory_t* inv, char const* name)
+{
+  device_info_t* info;
+
+  for (info = inv->items; info < inv->items + inv->n_items; info++)
+    {
+      if (strcmp (info->name, name) == 0)
+        {
+          set_fd (info->dirfd, -1);
+          *info = inv->items[--inv->n_items];
+          return true;
+        }
+    }
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+inventory_format (device_info_t const* info, char* dest, int size)
+{
+  return snprintf (dest, size, "%s type=%s max=%d current=%d bl_power=%d "
+                               "scale=%s",
+                   info->name, type_names[info->type], info->max,
+                   info->current, info->bl_power, scale_names[info->scale]);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+device_class_t
+inventory_class (char const* name)
+{
+  if (strncmp (name, LEDS_PREFIX, sizeof (LEDS_PREFIX) - 1) == 0)
+    return DEVICE_CLASS_LED;
+
+  return DEVICE_CLASS_BACKLIGHT;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+inventory_open (inventory_t* inv, char const* name, char const* attr,
+                int flags)
+{
+  device_info_t* info;
+
+  if ((info = inventory_find (inv, name)) == null)
+    {
+      errno = ENOENT;
+      return -1;
+    }
+
+  return openat (info->dirfd, device_attr (info->cls, attr), flags | O_CLOEXEC);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+inventory_access (inventory_t* inv, char const* name, char const* attr,
+                  int mode)
+{
+  device_info_t* info;
+
+  if ((info = inventory_find (inv, name)) == null)
+    return false;
+
+  return (faccessat (info->dirfd, device_attr (info->cls, attr), mode, 0) == 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,93 @@
+/*
+ * inventory.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_INVENTORY_H_
+#define SRC_INVENTORY_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define BACKLIGHT_DIR "/sys/class/backlight"
+#define LEDS_DIR "/sys/class/leds"
+//------------------------------------------------------------------------------
+// The LED devices are named with this prefix, the backlight ones are not.
+#define LEDS_PREFIX "leds/"
+//------------------------------------------------------------------------------
+// The values of bl_power, FB_BLANK_UNBLANK and FB_BLANK_POWERDOWN.
+#define BL_POWER_ON 0
+#define BL_POWER_OFF 4
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef enum device_class_t
+{
+  DEVICE_CLASS_BACKLIGHT,
+  DEVICE_CLASS_LED
+} device_class_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The order is the order of preference when a device is chosen
+// automatically.
+typedef enum device_type_t
+{
+  DEVICE_TYPE_UNKNOWN,
+  DEVICE_TYPE_RAW,
+  DEVICE_TYPE_PLATFORM,
+  DEVICE_TYPE_FIRMWARE
+} device_type_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef enum device_scale_t
+{
+  DEVICE_SCALE_UNKNOWN,
+  DEVICE_SCALE_LINEAR,
+  DEVICE_SCALE_NON_LINEAR
+} device_scale_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct device_info_t
+{
+  char name[STRSIZE];
+  device_class_t cls;
+  device_type_t type;
+  device_scale_t scale;
+  int max;
+  int current;
+  int bl_power;
+  int dirfd;
+} device_info_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The backlight and LED devices found in sysfs. It is built on the first use
+// and kept until it is invalidated by a hotplug event. The class
+// directories and the devices are held open as O_PATH descriptors, so an
+// attribute is a single lookup relative to them.
+typedef struct inventory_t
+{
+  bool_t valid;
+  int classes[2];
+  int n_items;
+  int capacity;
+  device_info_t* items;
+} inventory_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void inventory_init (inventory_t* inv);
+bool_t inventory_build (inventory_t* inv);
+void inventory_invalidate (inventory_t* inv);
+void inventory_clear (inventory_t* inv);
+device_info_t* inventory_find (inventory_t* inv, char const* name);
+device_info_t* inventory_best (inventory_t* inv);
+device_info_t* inventory_add (inventory_t* inv, char const* name);
+bool_t inventory_remove (inventory_t* inv, char const* name);
+int inventory_format (device_info_t const* info, char* dest, int size);
+device_class_t inventory_class (char const* name);
+int inventory_open (inventory_t* inv, char const* name, char const* attr,
+                    int flags);
+bool_t inventory_access (inventory_t* inv, char const* name, char const* attr,
+                         int mode);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_INVENTORY_H_ */
@@ -0,0 +1,87 @@
+/*
+ * latency.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <time.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define load(x) atomic_load_explicit (&(x), memory_order_relaxed)
+#define store(x, v) atomic_store_explicit (&(x), (v), memory_order_relaxed)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+long long
+latency_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+long long
+latency_boottime (void)
+{
+  struct timespec ts;
+
+  // Unlike the monotonic clock it goes on while the system sleeps.
+  clock_gettime (CLOCK_BOOTTIME, &ts);
+
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+latency_init (latency_t* lat, char const* name)
+{
+  lat->name = name;
+  atomic_init (&lat->count, 0);
+  atomic_init (&lat->total, 0);
+  atomic_init (&lat->max, 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+latency_add (latency_t* lat, long long start)
+{
+  latency_add_ns (lat, latency_now () - start);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+latency_add_ns (latency_t* lat, long long ns)
+{
+  ns = MAX (ns, 0LL);
+
+  // There is only one writer, so plain load/store pairs are enough.
+  store (lat->count, load (lat->count) + 1);
+  store (lat->total, load (lat->total) + ns);
+
+  if (ns > load (lat->max))
+    store (lat->max, ns);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+latency_format (latency_t const* lat, char* dest, int size)
+{
+  long long count = load (lat->count);
+  long long total = load (lat->total);
+  long long max = load (lat->max);
+
+  return snprintf (dest, size, "%s: count=%lld avg=%lldus max=%lldus",
+                   lat->name, count, count ? total / count / 1000 : 0,
+                   max / 1000);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#undef load
+#undef store
@@ -0,0 +1,35 @@
+/*
+ * latency.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_LATENCY_H_
+#define SRC_LATENCY_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdatomic.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Running statistics of one measured operation. It is updated by a single
+// thread and may be read at any time by another one.
+typedef struct latency_t
+{
+  char const* name;
+  atomic_llong count;
+  atomic_llong total;
+  atomic_llong max;
+} latency_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+long long latency_now (void);
+long long latency_boottime (void);
+void latency_init (latency_t* lat, char const* name);
+void latency_add (latency_t* lat, long long start);
+void latency_add_ns (latency_t* lat, long long ns);
+int latency_format (latency_t const* lat, char* dest, int size);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_LATENCY_H_ */
@@ -0,0 +1,57 @@
+/*
+ * levels.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define fround(x) __extension__(((__typeof__(x)) ((int) ((x) + 0.5))))
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+levels_init (levels_t* self, int max, int minimal, int num_levels)
+{
+  self->max = max;
+  self->num_levels = MIN (max, num_levels);
+  self->minimal = (minimal >= max) ? 0 : minimal;
+
+  if (self->num_levels > 0)
+    self->size = fround ((max - self->minimal) / (float) self->num_levels);
+  else
+    self->size = 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+levels_value (levels_t const* self, int level)
+{
+  int value = self->size * (float) level + self->minimal;
+
+  return MIN (value, self->max);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+levels_nearest (levels_t const* self, int value)
+{
+  int level = 0;
+
+  if (self->size > 0)
+    level = fround ((value - self->minimal) / (float) self->size);
+
+  return MAX (MIN (level, self->num_levels), 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+levels_percent (levels_t const* self, int percent)
+{
+  return fround (MAX (MIN (percent, 100), 0) * self->num_levels / 100.0f);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
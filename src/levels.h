@@ -0,0 +1,31 @@
+/*
+ * levels.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_LEVELS_H_
+#define SRC_LEVELS_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The levels of one device: 'num_levels' steps of 'size' from 'minimal'
+// up to 'max', the level 0 is the minimal brightness. A device with fewer
+// values than the levels asked for gets one level per value.
+typedef struct levels_t
+{
+  int max;
+  int minimal;
+  int num_levels;
+  int size;
+} levels_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void levels_init (levels_t* self, int max, int minimal, int num_levels);
+int levels_value (levels_t const* self, int level);
+int levels_nearest (levels_t const* self, int value);
+int levels_percent (levels_t const* self, int percent);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_LEVELS_H_ */
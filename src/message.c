@@ -0,0 +1,100 @@
+/*
+ * message.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+message_parse (char* line, message_t* msg)
+{
+  char* words[3];
+  char *word, *end, *save = null;
+  option_t const* opt;
+  int n = 0, i = 1;
+
+  // COMMAND [VALUE] [DEVICE], the value only for the commands that take
+  // one.
+  for (word = strtok_r (line, " \t\r", &save); word;
+       word = strtok_r (null, " \t\r", &save))
+    {
+      if (n == sizeof (words) / sizeof (*words))
+        {
+          _seterrf (msg->v_str, "%s", "Too many arguments");
+          return false;
+        }
+
+      words[n++] = word;
+    }
+
+  if (n == 0)
+    {
+      _seterrf (msg->v_str, "%s", "Missing command");
+      return false;
+    }
+
+  if (!(opt = opthash_find (words[0], strlen (words[0]))))
+    {
+      _seterrf (msg->v_str, "Unknown command '%s'", words[0]);
+      return false;
+    }
+
+  msg->field = opt->field;
+  msg->type = statics_types[opt->field];
+
+  switch (msg->type)
+    {
+    case TYPE_INT:
+      // 'set 40%' is the same as 'set 40'.
+      if (i < n && (msg->v_int = strtol (words[i], &end, 10), end > words[i])
+          && (!*end || strcmp (end, "%") == 0))
+        {
+          i++;
+          break;
+        }
+
+      _seterrf (msg->v_str, "Missing argument for '%s'", words[0]);
+      return false;
+
+    case TYPE_STRING:
+      if (i < n)
+        {
+          snprintf (msg->v_str, sizeof (msg->v_str), "%s", words[i++]);
+          break;
+        }
+
+      _seterrf (msg->v_str, "Missing argument for '%s'", words[0]);
+      return false;
+
+    default:
+      // A subscription may be given the granularity of its values.
+      if (msg->field != FIELD_WATCH)
+        break;
+
+      msg->v_int = -1;
+
+      if (i < n && isdigit ((unsigned char) *words[i]))
+        msg->v_int = atoi (words[i++]);
+    }
+
+  if (i < n)
+    snprintf (msg->device, sizeof (msg->device), "%s", words[i++]);
+
+  if (i == n)
+    return true;
+
+  _seterrf (msg->v_str, "%s", "Too many arguments");
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
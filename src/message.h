@@ -0,0 +1,19 @@
+/*
+ * message.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_MESSAGE_H_
+#define SRC_MESSAGE_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Fills the message from a line of the text protocol, 'COMMAND [VALUE]
+// [DEVICE]' with the names of the command line. The line is cut into its
+// words. On failure the error is left in 'v_str'.
+bool_t message_parse (char* line, message_t* msg);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_MESSAGE_H_ */
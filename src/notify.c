@@ -0,0 +1,111 @@
+/*
+ * notify.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+notify_init (notify_t* self)
+{
+  struct sockaddr_un addr;
+  char const* path = getenv ("NOTIFY_SOCKET");
+  char const* usec = getenv ("WATCHDOG_USEC");
+  char const* pid = getenv ("WATCHDOG_PID");
+  socklen_t len;
+
+  memset (self, 0, sizeof (*self));
+  self->fd = -1;
+  self->ping_at = -1;
+
+  if (!path || (*path != '/' && *path != '@')
+      || strlen (path) >= sizeof (addr.sun_path))
+    return;
+
+  // A name starting with '@' belongs to the abstract namespace.
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strncpy (addr.sun_path, path, sizeof (addr.sun_path) - 1);
+  len = offsetof (struct sockaddr_un, sun_path) + strlen (path);
+
+  if (*path == '@')
+    *addr.sun_path = 0;
+
+  if ((self->fd = socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) < 0)
+    return;
+
+  if (connect (self->fd, (struct sockaddr*) &addr, len) < 0)
+    {
+      eprintf ("%s: %s", path, strerror (errno));
+      set_fd (self->fd, -1);
+      return;
+    }
+
+  // The watchdog may be meant for another process.
+  if (usec && atoll (usec) > 0 && (!pid || atoi (pid) == getpid ()))
+    {
+      self->interval = atoll (usec) * 1000 / 2;
+      self->ping_at = latency_now () + self->interval;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+notify_clear (notify_t* self)
+{
+  set_fd (self->fd, -1);
+  self->ping_at = -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+notify_send (notify_t* self, char const* state)
+{
+  int len = strlen (state);
+
+  if (self->fd < 0)
+    return false;
+
+  return (send (self->fd, state, len, MSG_NOSIGNAL) == len);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+notify_status (notify_t* self, char const* status)
+{
+  char buf[STRSIZE + 8];
+
+  // Nothing is sent until the status really changes.
+  if (self->fd < 0 || strcmp (self->status, status) == 0)
+    return;
+
+  snprintf (self->status, sizeof (self->status), "%s", status);
+  snprintf (buf, sizeof (buf), "STATUS=%s", self->status);
+  notify_send (self, buf);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+notify_ping (notify_t* self, long long now)
+{
+  if (self->ping_at < 0 || now < self->ping_at)
+    return;
+
+  notify_send (self, "WATCHDOG=1");
+  self->ping_at = now + self->interval;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,32 @@
+/*
+ * notify.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_NOTIFY_H_
+#define SRC_NOTIFY_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The state reported to the service manager, see sd_notify(3). 'fd' is
+// -1 when the server was not started by it. The watchdog is pinged at
+// half of its interval, 'ping_at' is -1 without the watchdog.
+typedef struct notify_t
+{
+  int fd;
+  long long interval;
+  long long ping_at;
+  char status[STRSIZE];
+} notify_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void notify_init (notify_t* self);
+void notify_clear (notify_t* self);
+bool_t notify_send (notify_t* self, char const* state);
+void notify_status (notify_t* self, char const* status);
+void notify_ping (notify_t* self, long long now);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_NOTIFY_H_ */
@@ -0,0 +1,37 @@
+/*
+ * opthash.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_OPTHASH_H_
+#define SRC_OPTHASH_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define OPTHASH_BASIS 2166136261u
+#define OPTHASH_PRIME 16777619u
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// FNV-1a mixed with a seed. The seed and the size of the table are chosen
+// by tools/gen_options.c so that no two option names share a slot.
+static inline unsigned
+opthash_hash (char const* name, int len, unsigned seed)
+{
+  unsigned h = OPTHASH_BASIS ^ seed;
+  int i;
+
+  for (i = 0; i < len; i++)
+    h = (h ^ (unsigned char) name[i]) * OPTHASH_PRIME;
+
+  return (h ^ (h >> 16));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The option with the given long name, the name need not be terminated.
+// Defined in the generated opthash.c.
+option_t const* opthash_find (char const* name, int len);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_OPTHASH_H_ */
@@ -0,0 +1,130 @@
+/*
+ * ring.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+ring_init (ring_t* ring, int capacity, int item_size)
+{
+  unsigned size = 1;
+
+  // The capacity is rounded up to a power of two, so that the position
+  // of an item is a mask instead of a division.
+  while (size < (unsigned) capacity)
+    size <<= 1;
+
+  atomic_init (&ring->head, 0);
+  atomic_init (&ring->tail, 0);
+  ring->mask = size - 1;
+  ring->item_size = item_size;
+  ring->data = calloc (size, item_size);
+  ring->wakeup = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (ring->data && ring->wakeup >= 0)
+    return true;
+
+  ring_clear (ring);
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+ring_clear (ring_t* ring)
+{
+  if (!ring)
+    return;
+
+  ckfree (ring->data);
+  set_fd (ring->wakeup, -1);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+ring_push (ring_t* ring, void const* item)
+{
+  if (!ring_put (ring, item))
+    return false;
+
+  ring_wake (ring);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+ring_put (ring_t* ring, void const* item)
+{
+  unsigned head, tail;
+
+  head = atomic_load_explicit (&ring->head, memory_order_relaxed);
+  tail = atomic_load_explicit (&ring->tail, memory_order_acquire);
+
+  if (head - tail > ring->mask)
+    return false;
+
+  memcpy (ring->data + (head & ring->mask) * ring->item_size, item,
+          ring->item_size);
+  atomic_store_explicit (&ring->head, head + 1, memory_order_release);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+ring_wake (ring_t* ring)
+{
+  uint64_t one = 1;
+
+  // A saturated counter only means that the consumer is already due
+  // to wake up, so the result of the poke is not interesting here.
+  if (write (ring->wakeup, &one, sizeof (one)) < 0 && errno != EAGAIN)
+    eprintf ("%s", strerror (errno));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+ring_pop (ring_t* ring, void* item)
+{
+  unsigned head, tail;
+
+  tail = atomic_load_explicit (&ring->tail, memory_order_relaxed);
+  head = atomic_load_explicit (&ring->head, memory_order_acquire);
+
+  if (head == tail)
+    return false;
+
+  memcpy (item, ring->data + (tail & ring->mask) * ring->item_size,
+          ring->item_size);
+  atomic_store_explicit (&ring->tail, tail + 1, memory_order_release);
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+ring_ack (ring_t* ring)
+{
+  uint64_t count;
+
+  // Reset the eventfd counter before draining, so a push racing with
+  // the drain leaves the descriptor readable for the next poll().
+  if (read (ring->wakeup, &count, sizeof (count)) < 0)
+    return;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
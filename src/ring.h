@@ -0,0 +1,43 @@
+/*
+ * ring.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_RING_H_
+#define SRC_RING_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdatomic.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Lock-free single-producer/single-consumer queue of fixed-size items.
+// The producer pokes an eventfd after each push, so the consumer can
+// sleep in poll() on ring_fd() instead of spinning. A batch of items is
+// queued with ring_put() and announced with a single ring_wake().
+typedef struct ring_t
+{
+  atomic_uint head;
+  atomic_uint tail;
+  unsigned mask;
+  int item_size;
+  int wakeup;
+  char* data;
+} ring_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t ring_init (ring_t* ring, int capacity, int item_size);
+void ring_clear (ring_t* ring);
+bool_t ring_push (ring_t* ring, void const* item);
+bool_t ring_put (ring_t* ring, void const* item);
+void ring_wake (ring_t* ring);
+bool_t ring_pop (ring_t* ring, void* item);
+void ring_ack (ring_t* ring);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define ring_fd(r) ((r)->wakeup)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_RING_H_ */
@@ -0,0 +1,879 @@
+/*
+ * scheduler.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Every device may have a target and a device update in the queue.
+#define SCHED_QUEUE_SIZE (SCHED_MAX_DEVICES * 4)
+#define MSEC 1000000LL
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void* sched_thread (void* data);
+static bool_t sched_drain (sched_t* self);
+static bool_t sched_is_active (sched_t* self);
+static void sched_tick (sched_t* self, long long now);
+static void sched_finish (sched_t* self, int device, sched_event_type_t type);
+static void sched_power (sched_t* self, int device, int value);
+static void sched_sample (sched_t* self, int device, long long now);
+static void sched_watch (sched_t* self);
+static void sched_check (sched_t* self, int device);
+static void sched_complete (void* data, int slot, int value);
+static void sched_publish (sched_t* self);
+static void sched_probe (sched_t* self, int device);
+static void sched_advance (sched_t* self);
+static void sched_announce (sched_t* self);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static long long
+sched_monotonic (void* data __attribute__ ((unused)))
+{
+  return latency_now ();
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_init (sched_t* self)
+{
+  sched_device_t* dev;
+
+  memset (self, 0, sizeof (*self));
+
+  self->tick = SCHED_TICK;
+  self->deadline = -1;
+  self->clock = sched_monotonic;
+  self->updates.wakeup = -1;
+  self->events.wakeup = -1;
+  self->watch = -1;
+  atomic_init (&self->values, 0);
+
+  latency_init (&self->queue, "device.queue");
+  latency_init (&self->jitter, "device.jitter");
+  latency_init (&self->write, "device.write");
+  latency_init (&self->step, "device.tick");
+  latency_init (&self->first, "device.first");
+
+  if (!(self->devs = calloc (SCHED_MAX_DEVICES, sizeof (*self->devs))))
+    return false;
+
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    {
+      dev->get = -1;
+      dev->set = -1;
+      dev->power = -1;
+      dev->watch = -1;
+      dev->blank = -1;
+      dev->pending = -1;
+      dev->sample = -1;
+      dev->tick = SCHED_TICK;
+    }
+
+  return ((self->watch = epoll_create1 (EPOLL_CLOEXEC)) >= 0
+          && ring_init (&self->updates, SCHED_QUEUE_SIZE, sizeof (sched_update_t))
+          && ring_init (&self->events, SCHED_QUEUE_SIZE, sizeof (sched_event_t))
+          && devio_init (&self->io, SCHED_MAX_DEVICES)
+          && transition_init (&self->tr, SCHED_MAX_DEVICES));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+sched_clear (sched_t* self)
+{
+  sched_update_t upd;
+  sched_device_t* dev;
+
+  if (!self)
+    return;
+
+  sched_stop (self);
+
+  // Descriptors of the devices that were never handed over to the
+  // thread are still waiting in the queue.
+  while (self->updates.data && ring_pop (&self->updates, &upd))
+    {
+      if (upd.cmd != SCHED_DEVICE)
+        continue;
+
+      set_fd (upd.set, -1);
+      set_fd (upd.get, -1);
+      set_fd (upd.power, -1);
+      set_fd (upd.watch, -1);
+    }
+
+  for (dev = self->devs; dev && dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    {
+      set_fd (dev->set, -1);
+      set_fd (dev->get, -1);
+      set_fd (dev->power, -1);
+      set_fd (dev->watch, -1);
+    }
+
+  set_fd (self->watch, -1);
+
+  ckfree (self->devs);
+  ring_clear (&self->updates);
+  ring_clear (&self->events);
+  devio_clear (&self->io);
+  transition_clear (&self->tr);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_start (sched_t* self)
+{
+  sigset_t all, saved;
+  int rc;
+
+  if (self->started)
+    return true;
+
+  // The termination signals must interrupt the poll() of the IPC thread,
+  // so the device thread is started with all of them blocked.
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &saved);
+  rc = pthread_create (&self->thread, null, sched_thread, self);
+  pthread_sigmask (SIG_SETMASK, &saved, null);
+
+  if (rc != 0)
+    {
+      eprintf ("%s", strerror (rc));
+      return false;
+    }
+
+  self->started = true;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+sched_stop (sched_t* self)
+{
+  sched_update_t upd = { SCHED_QUIT, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, 0 };
+
+  if (!self->started)
+    return;
+
+  // A full queue may hold updates that were never committed, the thread
+  // is woken to drain them.
+  while (!ring_push (&self->updates, &upd))
+    {
+      ring_wake (&self->updates);
+      usleep (MSEC / 1000);
+    }
+
+  pthread_join (self->thread, null);
+  self->started = false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_set_device (sched_t* self, int device, int set, int get, int power,
+                  int watch, int max, int tick)
+{
+  sched_update_t upd = { SCHED_DEVICE, sched_now (self), device, max, tick, 0, 0,
+                         set, get, power, watch, 0 };
+
+  // With a 'tick' of 0 the device thread measures the device first and
+  // tells the cost with PROBED.
+  if (device >= 0 && device < SCHED_MAX_DEVICES
+      && ring_push (&self->updates, &upd))
+    return true;
+
+  set_fd (set, -1);
+  set_fd (get, -1);
+  set_fd (power, -1);
+  set_fd (watch, -1);
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_set_target (sched_t* self, int device, int value, int transition,
+                  int group)
+{
+  sched_update_t upd = { SCHED_TARGET, sched_now (self), device, value, 0,
+                         transition, group, -1, -1, -1, -1, self->origin };
+
+  if (!upd.origin)
+    upd.origin = upd.stamp;
+
+  // The targets come in batches, the thread is woken by sched_commit().
+  return (device >= 0 && device < SCHED_MAX_DEVICES && group >= 0
+          && group < SCHED_MAX_GROUPS && ring_put (&self->updates, &upd));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_set_power (sched_t* self, int device, int value, bool_t after)
+{
+  sched_update_t upd = { SCHED_POWER, sched_now (self), device, value, 0, after,
+                         0, -1, -1, -1, -1, 0 };
+
+  // With 'after' the power is changed when the running transition ends.
+  return (device >= 0 && device < SCHED_MAX_DEVICES
+          && ring_put (&self->updates, &upd));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_calibrate (sched_t* self, int device)
+{
+  sched_update_t upd = { SCHED_CALIBRATE, sched_now (self), device, 0, 0, 0, 0,
+                         -1, -1, -1, -1, 0 };
+
+  return (device >= 0 && device < SCHED_MAX_DEVICES
+          && ring_put (&self->updates, &upd));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_cancel (sched_t* self, int device)
+{
+  sched_update_t upd = { SCHED_CANCEL, sched_now (self), device, 0, 0, 0, 0,
+                         -1, -1, -1, -1, 0 };
+
+  return (device >= 0 && device < SCHED_MAX_DEVICES
+          && ring_put (&self->updates, &upd));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+sched_commit (sched_t* self)
+{
+  ring_wake (&self->updates);
+  self->origin = 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+sched_set_origin (sched_t* self, long long stamp)
+{
+  self->origin = stamp;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+sched_set_values (sched_t* self, bool_t enable)
+{
+  atomic_store_explicit (&self->values, enable, memory_order_relaxed);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+sched_set_clock (sched_t* self, sched_clock_t clock, void* data)
+{
+  // Set before the start. The thread sleeps in real time whatever the
+  // clock, a program with a clock of its own calls sched_step() instead.
+  self->clock = clock ? clock : sched_monotonic;
+  self->clock_data = data;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+long long
+sched_now (sched_t const* self)
+{
+  return self->clock (self->clock_data);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+long long
+sched_step (sched_t* self)
+{
+  // The loop of the device thread once, in the calling thread and
+  // without waiting: the updates, the finished requests and the tick
+  // that is due.
+  if (devio_is_async (&self->io))
+    devio_reap (&self->io, sched_complete, self);
+
+  sched_watch (self);
+  sched_drain (self);
+  sched_advance (self);
+  sched_announce (self);
+
+  return self->deadline;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+sched_tick_for (int write_us, int read_us)
+{
+  // A tick is four times longer than the write and its verification, so
+  // the device thread is mostly idle, but not shorter than a refresh of
+  // a 120 Hz panel.
+  return MAX (MIN ((write_us + read_us) * 4 / 1000, SCHED_TICK_MAX),
+              SCHED_TICK_MIN);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+sched_pop_event (sched_t* self, sched_event_t* event)
+{
+  return ring_pop (&self->events, event);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+sched_remaining (sched_t* self, int device)
+{
+  transition_t* tr = &self->tr;
+  unsigned msec = sched_now (self) / MSEC;
+  sched_device_t* dev;
+
+  // The state of the device thread is read, so it must be stopped.
+  if (self->started || device < 0 || device >= self->n_devs
+      || !(dev = self->devs + device)->active)
+    return 0;
+  else if (tr->from[device] < 0)
+    return dev->transition;
+
+  return MAX (dev->transition - (int) (msec - tr->start[device]), 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void*
+sched_thread (void* data)
+{
+  sched_t* self = (sched_t*) data;
+  struct pollfd ps[3] = { { ring_fd (&self->updates), POLLIN, 0 },
+                          { self->watch, POLLIN, 0 },
+                          { devio_fd (&self->io), POLLIN, 0 } };
+  int timeout;
+  bool_t quit = false;
+
+  while (!quit)
+    {
+      sched_announce (self);
+
+      // The ticks are planned on absolute deadlines, so neither the
+      // duration of the write nor the incoming updates shift them.
+      if (self->deadline < 0)
+        timeout = -1;
+      else
+        timeout = MAX (0LL, (self->deadline - sched_now (self) + MSEC - 1)
+                                / MSEC);
+
+      switch (poll (ps, 2 + devio_is_async (&self->io), timeout))
+        {
+        case -1:
+          if (errno != EINTR)
+            eprintf ("%s", strerror (errno));
+          continue;
+
+        case 0:
+          break;
+
+        default:
+          if (ps[2].revents)
+            devio_reap (&self->io, sched_complete, self);
+
+          if (ps[1].revents)
+            sched_watch (self);
+
+          if (ps[0].revents)
+            {
+              ring_ack (&self->updates);
+              quit = sched_drain (self);
+            }
+        }
+
+      if (!quit)
+        sched_advance (self);
+    }
+
+  return null;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_advance (sched_t* self)
+{
+  long long now = sched_now (self);
+
+  if (!sched_is_active (self))
+    self->deadline = -1;
+  else if (self->deadline < 0)
+    self->deadline = now;
+
+  if (self->deadline < 0 || now < self->deadline)
+    return;
+
+  latency_add_ns (&self->jitter, now - self->deadline);
+  sched_tick (self, now);
+  latency_add_ns (&self->step, sched_now (self) - now);
+
+  if (devio_submit (&self->io) && !devio_is_async (&self->io))
+    devio_reap (&self->io, sched_complete, self);
+
+  // Do not try to catch up the missed ticks after a slow write.
+  self->deadline = MAX (self->deadline + self->tick * MSEC, sched_now (self));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_announce (sched_t* self)
+{
+  if (self->notify)
+    {
+      ring_wake (&self->events);
+      self->notify = false;
+    }
+
+  if (self->publish && self->page)
+    sched_publish (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+sched_drain (sched_t* self)
+{
+  sched_update_t upd;
+  sched_device_t* dev;
+  transition_t* tr = &self->tr;
+  struct epoll_event ev;
+  int i;
+
+  while (ring_pop (&self->updates, &upd))
+    {
+      latency_add_ns (&self->queue, sched_now (self) - upd.stamp);
+      dev = self->devs + upd.device;
+      self->publish = true;
+
+      switch (upd.cmd)
+        {
+        case SCHED_QUIT:
+          return true;
+
+        case SCHED_DEVICE:
+          set_fd (dev->set, upd.set);
+          set_fd (dev->get, upd.get);
+          set_fd (dev->power, upd.power);
+          set_fd (dev->watch, upd.watch);
+          dev->blank = -1;
+          dev->max = upd.value;
+          dev->tick = upd.tick;
+          dev->stale = devio_busy (&self->io, upd.device);
+          dev->sample = -1;
+          dev->changed = false;
+          dev->active = false;
+          dev->pending = -1;
+          tr->current[upd.device] = -1;
+
+          // The changes made behind the back of the server are announced
+          // through sysfs_notify(). Most of the devices do it, the others
+          // are not watched. A watcher is armed by the first read.
+          if (dev->watch >= 0)
+            devio_get (&self->io, dev->watch);
+
+          ev.events = EPOLLPRI | EPOLLET;
+          ev.data.u32 = upd.device;
+
+          if (dev->watch >= 0
+              && epoll_ctl (self->watch, EPOLL_CTL_ADD, dev->watch, &ev) < 0)
+            set_fd (dev->watch, -1);
+
+          // A device of unknown cost is measured here, where its I/O is
+          // done from now on, and gets the tick that fits the cost.
+          if (dev->tick <= 0 && dev->set >= 0)
+            sched_probe (self, upd.device);
+
+          dev->tick = MAX (dev->tick, 1);
+
+          // All of the devices share the tick of the fastest one, and the
+          // tick covers only the devices up to the last one in use.
+          self->tick = SCHED_TICK_MAX;
+          self->n_devs = 0;
+
+          for (i = 0; i < SCHED_MAX_DEVICES; i++)
+            {
+              if (self->devs[i].set < 0)
+                continue;
+
+              self->tick = MIN (self->tick, self->devs[i].tick);
+              self->n_devs = i + 1;
+            }
+          break;
+
+        case SCHED_POWER:
+          if (upd.transition && dev->active)
+            dev->blank = upd.value;
+          else
+            sched_power (self, upd.device, upd.value);
+          break;
+
+        case SCHED_CANCEL:
+          // The device is left where the transition got, but the power
+          // it was to end with is applied at once. A calibration pass
+          // skips its remaining samples and sets the device back.
+          dev->active = false;
+
+          if (dev->sample >= 0 && dev->sample < SCHED_SAMPLES)
+            {
+              dev->lost += SCHED_SAMPLES - dev->sample;
+              dev->sample = SCHED_SAMPLES;
+            }
+
+          if (dev->blank >= 0)
+            sched_power (self, upd.device, dev->blank);
+          break;
+
+        case SCHED_CALIBRATE:
+          // The running transition is dropped, the server sets the target
+          // again after the pass. The pass is stepped by the ticks.
+          dev->active = false;
+
+          if (dev->sample < 0)
+            {
+              dev->sample = 0;
+              dev->saved = -1;
+              dev->lost = 0;
+            }
+          break;
+
+        case SCHED_TARGET:
+          if (dev->pending < 0)
+            tr->current[upd.device] = -1;
+
+          tr->target[upd.device] = MIN (upd.value, dev->max);
+          tr->from[upd.device] = -1;
+          dev->origin = upd.origin;
+          dev->transition = upd.transition;
+          dev->group = upd.group;
+          dev->active = (dev->set >= 0 && dev->get >= 0);
+        }
+    }
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+sched_is_active (sched_t* self)
+{
+  sched_device_t* dev;
+
+  for (dev = self->devs; dev < self->devs + self->n_devs; dev++)
+    if (dev->active || dev->sample >= 0)
+      return true;
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_tick (sched_t* self, long long now)
+{
+  transition_t* tr = &self->tr;
+  unsigned msec = now / MSEC;
+  sched_device_t* dev;
+  unsigned held = 0;
+  int i;
+
+  // A group waits for the slowest of its members.
+  for (dev = self->devs, i = 0; i < self->n_devs; dev++, i++)
+    if (dev->active && dev->group
+        && (devio_busy (&self->io, i) || tr->current[i] < 0))
+      held |= 1u << dev->group;
+
+  // The transitions that are ready to move get their starting point.
+  for (dev = self->devs, i = 0; i < self->n_devs; dev++, i++)
+    if (dev->active && dev->sample < 0 && tr->from[i] < 0
+        && tr->current[i] >= 0 && !devio_busy (&self->io, i)
+        && !(held & (1u << dev->group)))
+      transition_begin (tr, i, msec, dev->transition, self->tick);
+
+  transition_step (tr, self->n_devs, msec);
+
+  for (dev = self->devs, i = 0; i < self->n_devs; dev++, i++)
+    {
+      // The request of the previous tick is still in flight. The tick is
+      // skipped rather than queued, so a slow device never falls behind.
+      // A transition waits for the calibration pass of its device.
+      if (devio_busy (&self->io, i))
+        continue;
+      else if (dev->sample >= 0)
+        sched_sample (self, i, now);
+      else if (!dev->active)
+        continue;
+      else if (tr->current[i] < 0)
+        {
+          dev->issued = now;
+          devio_read (&self->io, i, dev->get);
+        }
+      else if (tr->current[i] == tr->target[i])
+        sched_finish (self, i, SCHED_EVENT_DONE);
+      else if (held & (1u << dev->group) || tr->value[i] == tr->current[i])
+        continue;
+      else
+        {
+          dev->issued = now;
+          dev->pending = tr->value[i];
+          devio_write (&self->io, i, dev->set, dev->get, dev->pending);
+
+          if (dev->origin)
+            latency_add_ns (&self->first, sched_now (self) - dev->origin);
+
+          dev->origin = 0;
+        }
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_probe (sched_t* self, int device)
+{
+  sched_device_t* dev = self->devs + device;
+  sched_event_t ev = { SCHED_EVENT_PROBED, device, -1, -1 };
+
+  if (devio_probe (&self->io, dev->set, dev->get, &ev.value, &ev.written))
+    dev->tick = sched_tick_for (ev.value, ev.written);
+  else
+    dev->tick = SCHED_TICK;
+
+  if (ring_put (&self->events, &ev))
+    self->notify = true;
+  else
+    eprintf ("%s", "The event queue is full");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_finish (sched_t* self, int device, sched_event_type_t type)
+{
+  sched_event_t ev = { type, device, self->tr.current[device],
+                       self->tr.target[device] };
+
+  self->devs[device].active = false;
+
+  if (self->devs[device].blank >= 0)
+    sched_power (self, device, self->devs[device].blank);
+
+  // The events of a tick are announced together by the thread loop.
+  if (ring_put (&self->events, &ev))
+    self->notify = true;
+  else
+    eprintf ("%s", "The event queue is full");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_power (sched_t* self, int device, int value)
+{
+  sched_device_t* dev = self->devs + device;
+
+  // The power is switched rarely, a plain write is good enough.
+  dev->blank = -1;
+
+  if (dev->power >= 0)
+    devio_set (&self->io, dev->power, value);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_sample (sched_t* self, int device, long long now)
+{
+  sched_device_t* dev = self->devs + device;
+  sched_event_t ev = { SCHED_EVENT_CALIBRATED, device, -1, 0 };
+
+  // One request per tick, like a step of a transition: the values are
+  // spread evenly over the range and each of them is read back. The
+  // pass starts from the current value and sets it back at the end.
+  if (dev->set < 0 || dev->get < 0)
+    dev->sample = SCHED_SAMPLES + 1;
+  else if (self->tr.current[device] < 0 && dev->saved < 0)
+    {
+      dev->issued = now;
+      devio_read (&self->io, device, dev->get);
+      return;
+    }
+  else if (dev->saved < 0)
+    dev->saved = self->tr.current[device];
+
+  if (dev->sample <= SCHED_SAMPLES)
+    {
+      dev->issued = now;
+      dev->pending = (dev->sample < SCHED_SAMPLES)
+                         ? (long long) dev->max * dev->sample
+                               / (SCHED_SAMPLES - 1)
+                         : dev->saved;
+      devio_write (&self->io, device, dev->set, dev->get, dev->pending);
+      dev->sample++;
+      return;
+    }
+
+  dev->sample = -1;
+  ev.value = self->tr.current[device];
+  ev.written = dev->lost;
+
+  if (ring_put (&self->events, &ev))
+    self->notify = true;
+  else
+    eprintf ("%s", "The event queue is full");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_complete (void* data, int slot, int value)
+{
+  sched_t* self = (sched_t*) data;
+  sched_device_t* dev = self->devs + slot;
+  int pending = dev->pending;
+
+  latency_add_ns (&self->write, sched_now (self) - dev->issued);
+
+  // The request was issued to a device that has been replaced since.
+  if (dev->stale)
+    {
+      dev->stale = false;
+      return;
+    }
+
+  self->tr.current[slot] = value;
+  dev->pending = -1;
+  self->publish = true;
+
+  // A sample of a calibration pass, the one that sets the device back is
+  // not. The pass is not waited for, a full queue loses the sample and
+  // the server does not trust the pass.
+  if (dev->sample > 0 && dev->sample <= SCHED_SAMPLES && pending >= 0)
+    {
+      sched_event_t ev = { SCHED_EVENT_SAMPLE, slot, value, pending };
+
+      if (ring_put (&self->events, &ev))
+        self->notify = true;
+      else
+        dev->lost++;
+    }
+
+  if (dev->sample >= 0)
+    {
+      if (dev->changed)
+        sched_check (self, slot);
+
+      return;
+    }
+
+  // The steps are of no use to the IPC thread unless it has subscribers
+  // for them, a full queue only loses a step.
+  if (dev->active && value >= 0
+      && atomic_load_explicit (&self->values, memory_order_relaxed))
+    {
+      sched_event_t ev = { SCHED_EVENT_VALUE, slot, value, pending };
+
+      self->notify = (ring_put (&self->events, &ev) || self->notify);
+    }
+
+  // A device may round the values written to it. The transition goes on
+  // from the rounded intermediate values and a rounded target ends it, so
+  // only a device that can not be read is stalled.
+  if (dev->active && value < 0)
+    sched_finish (self, slot, SCHED_EVENT_STALLED);
+  else if (dev->active && pending >= 0 && value != pending
+           && pending == self->tr.target[slot])
+    sched_finish (self, slot, SCHED_EVENT_ROUNDED);
+  else if (dev->active && value == self->tr.target[slot])
+    sched_finish (self, slot, SCHED_EVENT_DONE);
+
+  if (dev->changed)
+    sched_check (self, slot);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_watch (sched_t* self)
+{
+  struct epoll_event evs[16];
+  int n, i;
+
+  while ((n = epoll_wait (self->watch, evs, 16, 0)) > 0)
+    for (i = 0; i < n; i++)
+      {
+        // The value read back by a request in flight tells which of the
+        // changes are our own, so the check waits for it.
+        if (devio_busy (&self->io, evs[i].data.u32))
+          self->devs[evs[i].data.u32].changed = true;
+        else
+          sched_check (self, evs[i].data.u32);
+      }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_check (sched_t* self, int device)
+{
+  sched_device_t* dev = self->devs + device;
+  sched_event_t ev = { SCHED_EVENT_CHANGED, device, -1, -1 };
+
+  dev->changed = false;
+
+  // Only the attributes notified by the kernel are watched, so every write
+  // to the device is seen here; the writes of the thread itself leave the
+  // value it has read back. An unknown value is read anyway.
+  if (dev->watch < 0 || (ev.value = devio_get (&self->io, dev->watch)) < 0
+      || self->tr.current[device] < 0
+      || ev.value == self->tr.current[device])
+    return;
+
+  // The change made by someone else wins over the running transition.
+  self->tr.current[device] = ev.value;
+  dev->active = false;
+  dev->blank = -1;
+  self->publish = true;
+
+  if (ring_put (&self->events, &ev))
+    self->notify = true;
+  else
+    eprintf ("%s", "The event queue is full");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+sched_publish (sched_t* self)
+{
+  transition_t* tr = &self->tr;
+  unsigned msec = sched_now (self) / MSEC;
+  statpage_device_t* out = self->page->devs;
+  sched_device_t* dev;
+  float done;
+  int i;
+
+  self->publish = false;
+
+  // The rest of the entries belongs to the IPC thread.
+  statpage_begin (self->page);
+
+  for (dev = self->devs, i = 0; i < self->n_devs; dev++, out++, i++)
+    {
+      out->value = tr->current[i];
+      out->target = tr->target[i];
+
+      if (!dev->active)
+        out->progress = 1000;
+      else if (tr->from[i] < 0)
+        out->progress = 0;
+      else
+        {
+          done = (int) (msec - tr->start[i]) * tr->rate[i];
+          out->progress = MIN (done, 1.0f) * 1000;
+        }
+    }
+
+  statpage_end (self->page);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,184 @@
+/*
+ * scheduler.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_SCHEDULER_H_
+#define SRC_SCHEDULER_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <pthread.h>
+//------------------------------------------------------------------------------
+// The tick interval in milliseconds, the default one and the range of
+// the intervals chosen from the measured cost of the device I/O.
+#define SCHED_TICK 20
+#define SCHED_TICK_MIN 8
+#define SCHED_TICK_MAX 50
+//------------------------------------------------------------------------------
+// The number of devices driven at once and the range of the group ids.
+#define SCHED_MAX_DEVICES 512
+#define SCHED_MAX_GROUPS 32
+//------------------------------------------------------------------------------
+// The number of values written by a calibration pass.
+#define SCHED_SAMPLES 65
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The clock of the transitions in nanoseconds, the monotonic one unless
+// another one is given.
+typedef long long (*sched_clock_t) (void* data);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef enum sched_cmd_t
+{
+  SCHED_TARGET,
+  SCHED_DEVICE,
+  SCHED_POWER,
+  SCHED_CALIBRATE,
+  SCHED_CANCEL,
+  SCHED_QUIT
+} sched_cmd_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct sched_update_t
+{
+  sched_cmd_t cmd;
+  long long stamp;
+  int device;
+  int value;
+  int tick;
+  int transition;
+  int group;
+  int set;
+  int get;
+  int power;
+  int watch;
+  long long origin;
+} sched_update_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A transition ends with DONE when the device reports the target, with
+// ROUNDED when it reports another value instead of the target, and with
+// STALLED when it can not be read. A calibration pass reports each
+// written value with SAMPLE, one per tick, and ends with CALIBRATED once
+// the device is set back. CHANGED tells that
+// the brightness was changed by someone else. VALUE reports each step of
+// a transition while 'values' is set. PROBED has the measured cost of the
+// write and the read in microseconds in 'value' and 'written', -1 when
+// the device could not be measured.
+typedef enum sched_event_type_t
+{
+  SCHED_EVENT_DONE,
+  SCHED_EVENT_ROUNDED,
+  SCHED_EVENT_STALLED,
+  SCHED_EVENT_SAMPLE,
+  SCHED_EVENT_CALIBRATED,
+  SCHED_EVENT_CHANGED,
+  SCHED_EVENT_VALUE,
+  SCHED_EVENT_PROBED
+} sched_event_type_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'value' is the value read back from the device, 'written' is the value
+// that was written to it. CALIBRATED has the number of the samples lost
+// to a full queue or to a cancel in 'written' instead.
+typedef struct sched_event_t
+{
+  sched_event_type_t type;
+  int device;
+  int value;
+  int written;
+} sched_event_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The state of one device besides its transition. The devices of the
+// same non-zero group are moved in lockstep: none of them is stepped while
+// another one is busy or unread, so they start together and share the
+// progress. 'sample' is the index of the next value of a calibration
+// pass, -1 outside of one, and 'saved' the value it sets back at the end.
+typedef struct sched_device_t
+{
+  int max;
+  int get;
+  int set;
+  int power;
+  int watch;
+  int blank;
+  int group;
+  int tick;
+  int transition;
+  bool_t active;
+  bool_t stale;
+  bool_t changed;
+  int pending;
+  int sample;
+  int saved;
+  int lost;
+  long long issued;
+  long long origin;
+} sched_device_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The device I/O and the transition scheduler. Everything below 'thread'
+// is owned by the device thread once it is started; the IPC thread talks
+// to it only through the 'updates' and 'events' queues. The brightness is
+// published on 'page' when it is set before the start. 'origin' is the
+// time the queued targets were asked for, 'first' measures from it to
+// their first write. 'values' is set by the IPC thread when it wants the
+// VALUE events. 'deadline' is the time of the next tick, -1 while no
+// device moves.
+typedef struct sched_t
+{
+  ring_t updates;
+  ring_t events;
+  long long origin;
+  atomic_int values;
+  bool_t started;
+  pthread_t thread;
+  sched_clock_t clock;
+  void* clock_data;
+
+  devio_t io;
+  int watch;
+  bool_t notify;
+  struct statpage_t* page;
+  bool_t publish;
+  long long deadline;
+  int tick;
+  int n_devs;
+  sched_device_t* devs;
+  transition_t tr;
+
+  latency_t queue;
+  latency_t jitter;
+  latency_t write;
+  latency_t step;
+  latency_t first;
+} sched_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t sched_init (sched_t* self);
+void sched_clear (sched_t* self);
+bool_t sched_start (sched_t* self);
+void sched_stop (sched_t* self);
+bool_t sched_set_device (sched_t* self, int device, int set, int get,
+                         int power, int watch, int max, int tick);
+bool_t sched_set_target (sched_t* self, int device, int value, int transition,
+                         int group);
+bool_t sched_set_power (sched_t* self, int device, int value, bool_t after);
+bool_t sched_calibrate (sched_t* self, int device);
+bool_t sched_cancel (sched_t* self, int device);
+void sched_set_origin (sched_t* self, long long stamp);
+void sched_set_values (sched_t* self, bool_t enable);
+void sched_set_clock (sched_t* self, sched_clock_t clock, void* data);
+long long sched_now (sched_t const* self);
+long long sched_step (sched_t* self);
+int sched_tick_for (int write_us, int read_us);
+void sched_commit (sched_t* self);
+bool_t sched_pop_event (sched_t* self, sched_event_t* event);
+int sched_remaining (sched_t* self, int device);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_SCHEDULER_H_ */
@@ -7,39 +7,66 @@
  */
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+#define _GNU_SOURCE
 #include "includes.h"
 
 #include <asm-generic/socket.h>
-#include <dirent.h>
+#include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <fnmatch.h>
 #include <poll.h>
 #include <signal.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include <sys/stat.h>
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-#define MAX_POLL_SIZE 10
-#define POLL_TIMEOUT 20
-#define POLL_TIMEOUT_WAIT -1
-#define BACKLIGHT "/", "sys", "class", "backlight"
-#define fround(x) __extension__(((__typeof__(x)) ((int) ((x) + 0.5))))
+#define MAX_POLL_SIZE 256
+#define FLUSH_DELAY 1000
+#define FIRST_REPLY_BUDGET 50
+#define LISTEN_FDS_START 3
+#define DGRAM_BATCH 32
+#define HOTPLUG_BATCH 16
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static volatile bool_t g_total_quit = false;
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-typedef struct config_t
+// The client of the text protocol served at the moment, its answers are
+// turned into lines by reply().
+static int g_text_socket = -1;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The client whose command is performed at the moment, and whether the
+// callback has answered it already. A binary message is echoed only when
+// it has not, so each command gets exactly one answer ending with a
+// message that does not have 'read_more'.
+static int g_reply_socket = -1;
+static bool_t g_answered = false;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+_Static_assert (FIELD_NUM < 'A', "A binary message must not start as text");
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The fixed slots of the poll set, the clients take the rest.
+enum
 {
-  int minimal;
-  int num_levels;
-  int transition;
-  int saved_level;
-  char devname[STRSIZE];
-} config_t;
+  POLL_SOCKET,
+  POLL_EVENTS,
+  POLL_UEVENT,
+  POLL_RING,
+  POLL_DGRAM,
+  POLL_CLIENTS
+};
+
+_Static_assert (HANDOVER_MAX_CLIENTS >= MAX_POLL_SIZE - POLL_CLIENTS,
+                "A restart must pass all of the clients on");
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 typedef struct server_message_t
@@ -52,30 +79,163 @@ typedef struct server_message_t
 bool_t server_execute (server_t* ctx);
 void server_clear (server_t* self);
 static bool_t server_set_devname (server_t* self, char const* devname);
+static int server_select (server_t* self, char* names, char const** wanted);
+static bool_t server_attach (server_t* self);
+static bool_t server_set_device (server_t* self, int index,
+                                 char const* devname);
+static void server_unset_device (server_t* self, int index);
+static server_device_t* server_find (server_t* self, char const* devname);
+static void server_map_levels (server_t* self);
 static bool_t server_save (server_t* self, field_t field);
+static void server_save_level (server_t* self, server_device_t* dev);
+static void server_power_off (server_t* self, server_device_t* dev);
+static void server_power_on (server_t* self, server_device_t* dev);
 static bool_t server_load (server_t* self, field_t field);
+static void server_load_level (server_t* self, server_device_t* dev);
+static config_t* server_conf (server_t* self);
+static config_device_t* server_conf_device (server_t* self,
+                                            char const* devname);
+static config_map_t* server_conf_map (server_t* self, char const* devname);
+static int server_snap (server_t* self, server_device_t* dev, int target);
+static void server_learn (server_t* self, server_device_t* dev, int written,
+                          int actual);
+static void server_calibrate (server_t* self, server_device_t* dev);
+static void server_calibrated (server_t* self, server_device_t* dev,
+                               int lost);
+static bool_t server_flush (server_t* self);
+static void server_touch (server_t* self);
+static void server_probe (server_t* self, server_device_t* dev);
+static void server_probed (server_t* self, server_device_t* dev, int write_us,
+                           int read_us);
 static int server_is_running (server_t* self);
+static int server_lock (server_t* self);
+static bool_t server_reexec (server_t* self);
+static void server_handover (server_t* self, struct pollfd* clients,
+                             struct pollfd* end, struct ucred const* peers);
+static void server_adopt (server_t* self, struct pollfd* clients,
+                          struct ucred* peers);
+static void server_release (server_t* self);
+static int server_activated (int* dgram);
+static int server_restore (server_t* self);
+static char const* server_conf_path (server_t* self);
 static bool_t server_prepare (server_t* self);
-static void server_adjust (server_t* self);
+static char* server_dgram_path (server_t* self);
+static bool_t server_open_dgram (server_t* self);
+static int server_level_value (server_t* self, server_device_t* dev,
+                               int level);
+static int server_target (server_t* self, server_device_t* dev);
+static void server_retarget (server_t* self);
+static void server_retarget_with (server_t* self, int transition);
+static void server_status (server_t* self);
+static void server_publish (server_t* self);
+static void server_resync (server_t* self, server_device_t* dev, int value);
+static void server_notify (server_t* self, server_device_t* dev,
+                           watch_type_t type, int value);
+static void server_greet (server_t* self, int fd);
+static bool_t server_hold (server_t* self, int fd, message_t const* msg);
+static void server_answer (server_t* self);
+static void server_interrupt (server_t* self, char const* error);
+static void server_disconnect (server_t* self, struct pollfd* ps);
+static void server_events (server_t* self);
+static void server_hotplug (server_t* self);
+static bool_t server_open_ring (server_t* self);
+static void server_drain (server_t* self);
+static void server_receive (server_t* self);
 static bool_t server_start (server_t* self);
 static bool_t server_config (server_t* self, message_t const* msg);
 static bool_t server_command (server_t* self, message_t const* msg);
+static bool_t server_sleep (server_t* self, message_t const* msg);
 static bool_t cb_server_stop (server_t* self, server_message_t const* msg);
+static bool_t cb_server_ring (server_t* self, server_message_t const* msg);
+static bool_t cb_server_watch (server_t* self, server_message_t const* msg);
 static bool_t cb_server_get_saved (server_t* self, server_message_t const* msg);
 static bool_t cb_server_device_list (server_t* self,
                                      server_message_t const* msg);
-static bool_t device_name_is_valid (char const* name);
-static int get_device_max (char const* devname);
-static char* find_device (char* dest, int dest_size);
-static bool_t server_device_set (server_t* self, int value);
-static int server_device_get (server_t* self);
+static bool_t cb_server_stats (server_t* self, server_message_t const* msg);
+static bool_t device_name_is_valid (server_t* self, char const* name);
 static void set_signals (void);
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+static inline bool_t
+reply_line (int sock, char const* text)
+{
+  char line[BUFFER_SIZE];
+  int len;
+
+  len = snprintf (line, sizeof (line) - 1, "%s", text);
+  len = MIN (len, (int) sizeof (line) - 2);
+  line[len++] = '\n';
+
+  return (send (sock, line, len, MSG_NOSIGNAL) == len);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
 static inline int
 reply (int sock, void* data, int size)
 {
-  return send (sock, data, size, MSG_NOSIGNAL);
+  message_t const* msg = (message_t const*) data;
+  char value[16];
+
+  g_answered |= (sock == g_reply_socket);
+
+  if (sock != g_text_socket || size != sizeof (*msg))
+    return send (sock, data, size, MSG_NOSIGNAL);
+
+  // The values become lines of the text protocol, the end of the answer
+  // is told by the dispatcher.
+  switch (msg->type)
+    {
+    case TYPE_INT:
+      snprintf (value, sizeof (value), "%d", msg->v_int);
+      return reply_line (sock, value) ? size : -1;
+
+    case TYPE_STRING:
+    case TYPE_ERROR:
+      return reply_line (sock, msg->v_str) ? size : -1;
+
+    default:
+      return size;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline bool_t
+device_is_pattern (char const* name)
+{
+  return (strpbrk (name, "*?[") != null);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline bool_t
+device_is_selected (server_device_t const* dev, char const* device)
+{
+  return (dev->name && (!*device || strcmp (dev->name, device) == 0));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline bool_t
+server_is_moving (server_t const* self, char const* device)
+{
+  server_device_t const* dev;
+
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    if (dev->moving && device_is_selected (dev, device))
+      return true;
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline bool_t
+server_is_waiting (server_t const* self, int fd)
+{
+  server_waiter_t const* it;
+
+  for (it = self->waiters; it < self->waiters + self->n_waiters; it++)
+    if (it->fd == fd)
+      return true;
+
+  return false;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
@@ -87,26 +247,58 @@ server_init (context_t* ctx)
   if (!ctx)
     return;
 
-  server->timeout = POLL_TIMEOUT;
   server->socket = -1;
+  server->dgram = -1;
+  server->uevent = -1;
+  server->lock = -1;
+  server->ring_fd = -1;
+  server->ring_wake = -1;
+  server->requester = -1;
+  inventory_init (&server->inventory);
+  notify_init (&server->notify);
+  watch_init (&server->watch);
+
+  if (!sched_init (&server->sched))
+    eprintf ("%s", strerror (errno));
+
+  latency_init (&server->handle, "ipc.handle");
+  latency_init (&server->first, "ipc.first");
+  latency_init (&server->ring_delay, "ipc.ring");
+  latency_init (&server->receive, "ipc.dgram");
+  latency_init (&server->restore, "server.restore");
+  latency_init (&server->resume, "server.resume");
+  admission_init (&server->admission,
+                  statics_defaults[DEFAULT_RATE_LIMIT].v_int);
 
   context_bind (ctx, INC, server_command);
   context_bind (ctx, DEC, server_command);
   context_bind (ctx, ON, server_command);
   context_bind (ctx, OFF, server_command);
   context_bind (ctx, SWITCH, server_command);
+  context_bind (ctx, SET, server_command);
+  context_bind (ctx, CALIBRATE, server_command);
   context_bind (ctx, STOP, cb_server_stop);
   context_bind (ctx, RESTART, cb_server_stop);
+  context_bind (ctx, RING, cb_server_ring);
+  context_bind (ctx, WATCH, cb_server_watch);
   context_bind (ctx, SAVED, cb_server_get_saved);
   context_bind (ctx, LIST, cb_server_device_list);
+  context_bind (ctx, STATS, cb_server_stats);
   context_bind (ctx, MINIMAL, server_config);
   context_bind (ctx, NUM_LEVELS, server_config);
   context_bind (ctx, TRANSITION, server_config);
+  context_bind (ctx, LINKED, server_config);
+  context_bind (ctx, FADE_BLANK, server_config);
   context_bind (ctx, DEVNAME, server_config);
   context_bind (ctx, SOCKNAME, server_config);
   context_bind (ctx, WORKDIR, server_config);
   context_bind (ctx, PIDFILE, server_config);
   context_bind (ctx, DAEMON, server_config);
+  context_bind (ctx, RATE_LIMIT, server_config);
+  context_bind (ctx, IDLE_EXIT, server_config);
+  context_bind (ctx, RESTORE, server_config);
+  context_bind (ctx, SLEEP, server_sleep);
+  context_bind (ctx, WAKE, server_sleep);
   context_bind (ctx, CONFIG, server_config);
 
   ctx->run = (exec_func_t) server_execute;
@@ -118,37 +310,83 @@ bool_t
 server_execute (server_t* self)
 {
   bool_t result;
-  int fd;
+  long long took;
+  int n;
+
+  self->started_at = latency_now ();
+  self->active_at = latency_boottime ();
+
+  // The saved brightness comes first, everything else is done after the
+  // panel already shows it. After a restart the panel is left as the
+  // previous image has left it.
+  if ((self->handover = handover_take ()))
+    n = -1;
+  else
+    n = server_restore (self);
+
+  took = latency_now () - self->started_at;
+
+  if (n >= 0)
+    latency_add_ns (&self->restore, took);
+
+  if (self->oneshot)
+    {
+      if (n >= 0)
+        printf ("Restored %d devices in %lldus\n", n, took / 1000);
+
+      return (n >= 0);
+    }
 
   self->minimal = statics_defaults[DEFAULT_MINIMAL].v_int;
   self->num_levels = statics_defaults[DEFAULT_NUM_LEVELS].v_int;
   self->transition = statics_defaults[DEFAULT_TRANSITION].v_int;
 
-  if (self->daemon && daemon (false, true) < 0)
-    eprintf ("%s", strerror (errno));
-
-  if (!server_prepare (self))
-    return false;
+  // The previous image has already been through daemon() and passes its
+  // socket and lock on with the same PID.
+  if (self->handover)
+    {
+      self->socket = self->handover->socket;
+      self->dgram = self->handover->dgram;
+      self->lock = self->handover->lock;
+      self->activated = self->handover->activated;
+    }
   else
     {
-      switch (fd = creat (self->pidfile, 00664))
-        {
-        case -1:
-          eprintf ("%s: %s", self->pidfile, strerror (errno));
-          break;
+      // The socket passed by the service manager belongs to this very
+      // process, so it is taken before the fork of daemon().
+      self->activated = ((self->socket = server_activated (&self->dgram)) >= 0);
 
-        default:
-          fs_setint (fd, getpid ());
-          close (fd);
-        }
+      if (self->daemon && daemon (false, true) < 0)
+        eprintf ("%s", strerror (errno));
     }
 
+  if (ring_fd (&self->sched.updates) < 0 || ring_fd (&self->sched.events) < 0)
+    return false;
+  else if (!server_prepare (self))
+    return false;
+
   set_signals ();
 
   result = server_start (self);
 
-  unlink (self->pidfile);
-  unlink (self->socketname);
+  // Returns only when the next image could not be started.
+  if (result && self->restart)
+    result = server_reexec (self);
+
+  // The PID file is not removed, the lock on it is what tells that the
+  // server is running.
+  if (ftruncate (self->lock, 0) < 0)
+    eprintf ("%s: %s", self->pidfile, strerror (errno));
+
+  // The socket of the service manager outlives the server.
+  if (!self->activated && !fs_socket_is_abstract (self->socketname))
+    {
+      char* path = server_dgram_path (self);
+
+      unlink (self->socketname);
+      unlink (path);
+      ckfree (path);
+    }
 
   return result;
 }
@@ -157,6 +395,8 @@ server_execute (server_t* self)
 void
 server_clear (server_t* self)
 {
+  server_device_t* dev;
+
   if (!self)
     return;
 
@@ -164,71 +404,258 @@ server_clear (server_t* self)
   ckfree (self->socketname);
   ckfree (self->workdir);
   ckfree (self->config);
-  ckfree (self->dev.name);
-  set_fd (self->dev.set, -1);
-  set_fd (self->dev.get, -1);
+  ckfree (self->handover);
+
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    ckfree (dev->name);
+
+  sched_clear (&self->sched);
+  watch_clear (&self->watch);
+  statpage_destroy (self->page);
+  cmdring_destroy (self->ring);
+  set_fd (self->ring_fd, -1);
+  set_fd (self->ring_wake, -1);
+  inventory_clear (&self->inventory);
+  notify_clear (&self->notify);
+  set_fd (self->uevent, -1);
   set_fd (self->socket, -1);
+  set_fd (self->dgram, -1);
+  set_fd (self->lock, -1);
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
 server_set_devname (server_t* self, char const* devname)
 {
-  if (device_name_is_valid (devname))
+  config_t* conf = server_conf (self);
+  char names[sizeof (conf->devname)];
+  char *name, *save;
+
+  if (strlen (devname) >= sizeof (names))
+    return false;
+
+  // An empty list returns the choice of the device to the server.
+  strcpy (names, devname);
+
+  for (name = strtok_r (names, ",", &save); name;
+       name = strtok_r (null, ",", &save))
+    if (!device_is_pattern (name) && !device_name_is_valid (self, name))
+      return false;
+
+  if (strcmp (conf->devname, devname))
+    {
+      memset (conf->devname, 0, sizeof (conf->devname));
+      strcpy (conf->devname, devname);
+      server_touch (self);
+    }
+
+  return server_attach (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_select (server_t* self, char* names, char const** wanted)
+{
+  config_t* conf = server_conf (self);
+  inventory_t* inv = &self->inventory;
+  char *name, *save;
+  server_device_t* dev;
+  device_info_t* info;
+  device_info_t* best;
+  int n = 0;
+
+  memcpy (names, conf->devname, sizeof (conf->devname));
+  names[sizeof (conf->devname) - 1] = 0;
+  inventory_build (inv);
+
+  // The devices chosen by the user, as many of them as are present. A
+  // pattern takes all of the devices it matches.
+  for (name = strtok_r (names, ",", &save); name && n < SCHED_MAX_DEVICES;
+       name = strtok_r (null, ",", &save))
     {
-      float tmp;
-      char *get, *set;
+      if (!device_is_pattern (name))
+        {
+          if (device_name_is_valid (self, name))
+            wanted[n++] = name;
+          continue;
+        }
+
+      for (info = inv->items;
+           info < inv->items + inv->n_items && n < SCHED_MAX_DEVICES; info++)
+        if (fnmatch (name, info->name, FNM_PATHNAME) == 0
+            && device_name_is_valid (self, info->name))
+          wanted[n++] = info->name;
+    }
 
-      ckfree (self->dev.name);
-      set_fd (self->dev.set, -1);
-      set_fd (self->dev.get, -1);
+  // Otherwise the devices chosen automatically are kept while they live,
+  // and the best one is taken when all of them are gone.
+  for (dev = self->devs; n == 0 && dev < self->devs + SCHED_MAX_DEVICES;
+       dev++)
+    if (dev->name && device_name_is_valid (self, dev->name))
+      wanted[n++] = dev->name;
 
-      set = fs_path_join (BACKLIGHT, devname, "brightness", null);
-      get = fs_path_join (BACKLIGHT, devname, "actual_brightness", null);
+  if (n == 0 && (best = inventory_best (&self->inventory)))
+    wanted[n++] = best->name;
 
-      self->dev.name = strdup (devname);
-      self->dev.max = get_device_max (devname);
-      self->dev.set = open (set, O_WRONLY);
-      self->dev.get = open (get, O_RDONLY);
+  return n;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_attach (server_t* self)
+{
+  config_t* conf = server_conf (self);
+  char const* wanted[SCHED_MAX_DEVICES];
+  char names[sizeof (conf->devname)];
+  server_device_t* dev;
+  int i, j, n;
 
-      self->num_levels = MIN (self->dev.max, self->num_levels);
-      self->minimal = self->minimal >= self->dev.max ? 0 : self->minimal;
-      tmp = (self->dev.max - self->minimal) / (float) self->num_levels;
-      self->level_size = fround (tmp);
-      self->level = self->num_levels >> 1;
+  n = server_select (self, names, wanted);
 
-      ckfree (set);
-      ckfree (get);
+  for (i = 0; i < SCHED_MAX_DEVICES; i++)
+    {
+      if (!(dev = self->devs + i)->name)
+        continue;
 
-      return true;
+      for (j = 0; j < n && strcmp (dev->name, wanted[j]); j++)
+        ;
+
+      if (j == n)
+        server_unset_device (self, i);
     }
 
-  return false;
+  for (j = 0; j < n; j++)
+    {
+      if (server_find (self, wanted[j]))
+        continue;
+
+      for (i = 0; i < SCHED_MAX_DEVICES && self->devs[i].name; i++)
+        ;
+
+      if (i < SCHED_MAX_DEVICES)
+        server_set_device (self, i, wanted[j]);
+    }
+
+  if (n == 0)
+    eprintf ("%s", "No backlight device is available");
+
+  return (n > 0);
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
-server_save (server_t* self, field_t field)
+server_set_device (server_t* self, int index, char const* devname)
 {
-  int n_fields_to_save = 0;
-  config_t conf;
-  int fd;
+  server_device_t* dev = self->devs + index;
 
-  switch (fd = open (self->config, O_RDONLY))
+  if (device_name_is_valid (self, devname))
     {
-    default:
-      if (read (fd, &conf, sizeof (conf)) == sizeof (conf))
-        break;
-      /* no break */
-    case -1:
-      memset (conf.devname, 0, sizeof (conf.devname));
-      conf.minimal = -1;
-      conf.num_levels = -1;
-      conf.saved_level = -1;
-      conf.transition = -1;
+      inventory_t* inv = &self->inventory;
+      int getfd, setfd, watchfd, powerfd = -1;
+      device_info_t* info;
+
+      ckfree (dev->name);
+
+      dev->name = strdup (devname);
+      info = inventory_find (inv, devname);
+      dev->max = info ? info->max : 0;
+      dev->power = info ? info->bl_power : -1;
+      dev->blanked = (dev->power > BL_POWER_ON);
+      dev->rounded = (server_conf_map (self, devname)->n_pairs > 0);
+      dev->calibrating = -1;
+      dev->target = -1;
+
+      // The setting is read back by the probe of the device thread.
+      if ((setfd = inventory_open (inv, devname, "brightness", O_RDWR)) < 0)
+        setfd = inventory_open (inv, devname, "brightness", O_WRONLY);
+
+      getfd = inventory_open (inv, devname, "actual_brightness", O_RDONLY);
+
+      // The LEDs announce the changes made by the hardware with their own
+      // attribute, the backlights with actual_brightness. The brightness of
+      // an LED is never notified, an LED without the attribute is not
+      // watched and the changes of others are seen by the next transition.
+      if ((watchfd = inventory_open (inv, devname, "brightness_hw_changed",
+                                     O_RDONLY))
+              < 0
+          && inventory_class (devname) != DEVICE_CLASS_LED)
+        watchfd = inventory_open (inv, devname, "actual_brightness", O_RDONLY);
+
+      if (dev->power >= 0
+          && (powerfd = inventory_open (inv, devname, "bl_power", O_WRONLY))
+                 < 0)
+        dev->power = -1;
+      server_probe (self, dev);
+
+      // The descriptors are owned by the device thread from now on.
+      sched_set_device (&self->sched, index, setfd, getfd, powerfd, watchfd,
+                        dev->max, dev->tick);
+
+      server_map_levels (self);
+      server_load_level (self, dev);
+      dev->moving = false;
+      server_notify (self, dev, WATCH_ADDED, info ? info->current : -1);
+
+      return true;
     }
 
-  set_fd (fd, -1);
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_unset_device (server_t* self, int index)
+{
+  server_device_t* dev = self->devs + index;
+
+  if (dev->name)
+    server_notify (self, dev, WATCH_REMOVED, -1);
+
+  ckfree (dev->name);
+  dev->max = 0;
+  dev->target = -1;
+  dev->moving = false;
+  sched_set_device (&self->sched, index, -1, -1, -1, -1, 0, SCHED_TICK);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static server_device_t*
+server_find (server_t* self, char const* devname)
+{
+  server_device_t* dev;
+
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    if (dev->name && strcmp (dev->name, devname) == 0)
+      return dev;
+
+  return null;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_map_levels (server_t* self)
+{
+  server_device_t* dev;
+
+  // The levels are the same for all of the devices, each of them maps
+  // the levels to its own range.
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    {
+      if (!dev->name)
+        continue;
+
+      levels_init (&dev->levels, dev->max, self->minimal, self->num_levels);
+      dev->level = MIN (dev->level, dev->levels.num_levels);
+      dev->target = -1;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_save (server_t* self, field_t field)
+{
+  int n_fields_to_save = 0;
+  config_t* conf = server_conf (self);
 
   switch (field)
     {
@@ -236,278 +663,1633 @@ server_save (server_t* self, field_t field)
       return false;
 
     case FIELD_TRANSITION:
-      if (self->transition >= 0 && conf.transition != self->transition)
+      if (self->transition >= 0 && conf->transition != self->transition)
         {
-          conf.transition = self->transition;
+          conf->transition = self->transition;
           n_fields_to_save++;
         }
 
       break;
 
     case FIELD_MINIMAL:
-      if (self->minimal >= 0 && conf.minimal != self->minimal)
+      if (self->minimal >= 0 && conf->minimal != self->minimal)
         {
-          conf.minimal = self->minimal;
+          conf->minimal = self->minimal;
           n_fields_to_save++;
         }
       break;
 
     case FIELD_NUM_LEVELS:
-      if (self->num_levels >= 0 && conf.num_levels != self->num_levels)
+      if (self->num_levels >= 0 && conf->num_levels != self->num_levels)
         {
-          conf.num_levels = self->num_levels;
+          conf->num_levels = self->num_levels;
           n_fields_to_save++;
         }
       break;
 
-    case FIELD_DEVNAME:
-      if (self->dev.name && strcmp (self->dev.name, conf.devname))
+    case FIELD_LINKED:
+      if (conf->linked != (int) self->linked)
         {
-          memset (conf.devname, 0, sizeof (conf.devname));
-          strcpy (conf.devname, self->dev.name);
+          conf->linked = self->linked;
           n_fields_to_save++;
         }
       break;
 
-    case FIELD_SAVED:
-      if (self->level >= 0 && conf.saved_level != self->level)
+    case FIELD_FADE_BLANK:
+      if (conf->fade_blank != (int) self->fade_blank)
         {
-          conf.saved_level = self->level;
+          conf->fade_blank = self->fade_blank;
           n_fields_to_save++;
         }
     }
 
   if (n_fields_to_save)
-    {
-      switch (fd = creat (self->config, 00664))
-        {
-        default:
-          if (write (fd, &conf, sizeof (conf)) == sizeof (conf))
-            {
-              set_fd (fd, -1);
-              return true;
-            }
-          set_fd (fd, -1);
-          /* no break */
-        case -1:
-          return false;
-        }
-    }
+    server_touch (self);
 
   return true;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-static bool_t
-server_load (server_t* self, field_t field)
+static void
+server_save_level (server_t* self, server_device_t* dev)
 {
-  config_t conf;
-  int size = sizeof (conf);
-  int fd;
+  config_device_t* entry = server_conf_device (self, dev->name);
+  int* value = self->conf.values + (entry - self->conf.devices);
 
-  switch (fd = open (self->config, O_RDONLY))
+  if (dev->level >= 0
+      && (entry->level != dev->level
+          || *value != server_level_value (self, dev, dev->level)))
     {
-    default:
-      if (read (fd, &conf, size) == size)
-        break;
-      /* no break */
-    case -1:
-      memset (&conf, -1, size);
-      memset (conf.devname, 0, sizeof (conf.devname));
+      entry->level = dev->level;
+      *value = server_level_value (self, dev, dev->level);
+      server_touch (self);
     }
-
-  set_fd (fd, -1);
-
-  if (conf.minimal < 0)
-    conf.minimal = statics_defaults[DEFAULT_MINIMAL].v_int;
-
-  if (conf.num_levels < 0)
-    conf.num_levels = statics_defaults[DEFAULT_NUM_LEVELS].v_int;
-
-  if (conf.transition < 0)
-    conf.transition = statics_defaults[DEFAULT_TRANSITION].v_int;
-
-  switch (field)
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_touch (server_t* self)
+{
+  // The file is written later by server_flush(), so a burst of commands
+  // costs a single write.
+  if (!self->dirty)
     {
-    default:
-      return false;
-
-    case FIELD_NONE:
-
-    case FIELD_DEVNAME:
-      if (!conf.devname[0]
-          && find_device (conf.devname, sizeof (conf.devname)) == null)
-        return false;
-
-      if (!server_set_devname (self, conf.devname))
-        return false;
-      else if (field != FIELD_NONE)
-        break;
-      /* no break */
+      self->dirty = true;
+      self->flush_at = latency_now () + FLUSH_DELAY * 1000000LL;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_probe (server_t* self, server_device_t* dev)
+{
+  config_device_t* entry = server_conf_device (self, dev->name);
 
-    case FIELD_MINIMAL:
-      self->minimal = conf.minimal >= self->dev.max ? 0 : conf.minimal;
+  // The costs are measured once per device, the result is kept in the
+  // state file next to the name of the device. An unknown one is measured
+  // by the device thread, which owns the I/O, and comes with PROBED.
+  dev->write_cost = entry->write_cost;
+  dev->read_cost = entry->read_cost;
 
-      if (field != FIELD_NONE)
-        break;
-      /* no break */
+  if (entry->write_cost < 0 || entry->read_cost < 0)
+    dev->tick = 0;
+  else
+    dev->tick = sched_tick_for (dev->write_cost, dev->read_cost);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_probed (server_t* self, server_device_t* dev, int write_us,
+               int read_us)
+{
+  config_device_t* entry = server_conf_device (self, dev->name);
 
-    case FIELD_NUM_LEVELS:
-      {
-        self->num_levels = MIN (self->dev.max, conf.num_levels);
-        float tmp = (self->dev.max - self->minimal) / (float) self->num_levels;
-        self->level_size = fround (tmp);
+  // A device that could not be measured is measured again the next time
+  // it is taken, with the default tick until then.
+  if (write_us < 0 || read_us < 0)
+    {
+      dev->tick = SCHED_TICK;
+      return;
+    }
 
-        if (field != FIELD_NONE)
-          break;
-      }
-      /* no break */
-    case FIELD_SAVED:
-      if (conf.saved_level >= 0 && conf.saved_level < self->num_levels)
-        self->level = conf.saved_level;
-      else
-        self->level = self->num_levels >> 1;
+  entry->write_cost = dev->write_cost = write_us;
+  entry->read_cost = dev->read_cost = read_us;
+  dev->tick = sched_tick_for (write_us, read_us);
+  server_touch (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_conf_reset (config_t* conf)
+{
+  config_device_t* entry;
 
-      if (field != FIELD_NONE)
-        break;
-      /* no break */
+  memset (conf, -1, sizeof (*conf));
+  memset (conf->devname, 0, sizeof (conf->devname));
+  memset (conf->probed, 0, sizeof (conf->probed));
 
-    case FIELD_TRANSITION:
-      self->transition = conf.transition;
-    }
+  for (entry = conf->devices; entry < conf->devices + CONFIG_MAX_DEVICES;
+       entry++)
+    memset (entry->name, 0, sizeof (entry->name));
 
-  return true;
+  memset (conf->maps, 0, sizeof (conf->maps));
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-static int
-server_is_running (server_t* self)
+static config_t*
+server_conf (server_t* self)
 {
-  char spid[16];
-  int pid, fd;
-
-  if ((fd = open (self->pidfile, O_RDONLY)) < 0)
-    return 0;
+  config_t* conf = &self->conf;
+  int size = sizeof (*conf);
+  int fd;
 
-  close (fd);
+  if (self->conf_loaded)
+    return conf;
 
-  if ((pid = fs_getint (fd)) == 0)
-    return 0;
+  server_conf_reset (conf);
 
-  snprintf (spid, 16, "/proc/%i", pid);
+  // The files of the older versions are shorter, their missing fields
+  // keep the defaults.
+  switch (fd = open (server_conf_path (self), O_RDONLY))
+    {
+    default:
+      if (read (fd, conf, size) >= (int) CONFIG_V1_SIZE)
+        break;
+      /* no break */
+    case -1:
+      server_conf_reset (conf);
+    }
 
-  if (fs_test (spid, FS_EXISTS))
-    return pid;
+  set_fd (fd, -1);
+  self->conf_loaded = true;
 
-  return 0;
+  return conf;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-static bool_t
-server_prepare (server_t* self)
+static char const*
+server_conf_path (server_t* self)
 {
-  int pid;
-
   context_spw_init ((context_t*) self);
 
   if (!self->config)
     self->config = fs_path_join (self->workdir,
                                  statics_defaults[DEFAULT_CONFIG].v_str, null);
 
-  if ((pid = server_is_running (self)) > 0)
+  return self->config;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_restore (server_t* self)
+{
+  config_t const* conf;
+  char const* wanted[SCHED_MAX_DEVICES];
+  char names[sizeof (conf->devname)];
+  int fd, i, j, k, n = 0;
+
+  context_spw_init ((context_t*) self);
+
+  // A running server owns the devices.
+  if (server_is_running (self) > 0)
+    return -1;
+
+  // The file is read once, the server goes on with it. A missing or a
+  // short one, of the first start or of an older version, restores the
+  // devices it has values for, maybe none, and is not an error.
+  conf = server_conf (self);
+
+  // Only the devices the server would take are written, the others may
+  // be driven by someone else since the values were saved.
+  k = server_select (self, names, wanted);
+
+  for (i = 0; i < CONFIG_MAX_DEVICES; i++)
+    {
+      if (!*conf->devices[i].name || conf->values[i] < 0)
+        continue;
+
+      for (j = 0; j < k && strcmp (conf->devices[i].name, wanted[j]); j++)
+        ;
+
+      if (j == k)
+        continue;
+
+      fd = inventory_open (&self->inventory, conf->devices[i].name,
+                           "brightness", O_WRONLY);
+
+      if (fd >= 0)
+        {
+          fs_setint (fd, conf->values[i]);
+          n++;
+        }
+
+      set_fd (fd, -1);
+    }
+
+  return n;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static config_device_t*
+server_conf_device (server_t* self, char const* devname)
+{
+  config_t* conf = server_conf (self);
+  config_device_t* end = conf->devices + CONFIG_MAX_DEVICES;
+  config_device_t* entry;
+
+  for (entry = conf->devices; entry < end; entry++)
+    if (strncmp (entry->name, devname, sizeof (entry->name)) == 0)
+      return entry;
+
+  // A new device takes a free entry, or the last one when all of them
+  // are in use.
+  for (entry = conf->devices; entry < end - 1 && *entry->name; entry++)
+    ;
+
+  memset (entry, -1, sizeof (*entry));
+  memset (entry->name, 0, sizeof (entry->name));
+  memset (conf->maps + (entry - conf->devices), 0, sizeof (*conf->maps));
+  conf->values[entry - conf->devices] = -1;
+  strncpy (entry->name, devname, sizeof (entry->name) - 1);
+
+  return entry;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static config_map_t*
+server_conf_map (server_t* self, char const* devname)
+{
+  config_device_t* entry = server_conf_device (self, devname);
+
+  return self->conf.maps + (entry - self->conf.devices);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_snap (server_t* self, server_device_t* dev, int target)
+{
+  config_map_t* map;
+  config_pair_t* it;
+  int best = -1;
+
+  // Most of the devices take any value, they never look up the map.
+  if (!dev->rounded)
+    return target;
+
+  map = server_conf_map (self, dev->name);
+
+  // A target seen before is replaced with the value the device gave back
+  // for it. With a calibrated map any other one goes to the nearest value
+  // the device can reach.
+  for (it = map->pairs; it < map->pairs + map->n_pairs; it++)
+    {
+      if (it->written == target)
+        return it->actual;
+      else if (map->calibrated > 0
+               && (best < 0 || abs (it->actual - target) < abs (best - target)))
+        best = it->actual;
+    }
+
+  return best < 0 ? target : best;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_learn (server_t* self, server_device_t* dev, int written, int actual)
+{
+  config_map_t* map = server_conf_map (self, dev->name);
+  config_pair_t* end = map->pairs + map->n_pairs;
+  config_pair_t* it;
+
+  if (written < 0 || actual < 0)
+    return;
+
+  // A calibration keeps a single pair for each value the device reaches,
+  // the normal use keeps one for each rounded target.
+  for (it = map->pairs; it < end; it++)
+    if (dev->calibrating >= 0 ? it->actual == actual : it->written == written)
+      break;
+
+  if (it == end && map->n_pairs < CONFIG_MAX_PAIRS)
+    map->n_pairs++;
+  else if (it == end && dev->calibrating >= 0)
+    {
+      dev->overflow = true;
+      return;
+    }
+  else if (it == end)
+    {
+      // The oldest pair gives way to the new one.
+      memmove (map->pairs, map->pairs + 1,
+               (CONFIG_MAX_PAIRS - 1) * sizeof (*it));
+      it = end - 1;
+    }
+
+  it->written = written;
+  it->actual = actual;
+  dev->rounded = true;
+  server_touch (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_calibrate (server_t* self, server_device_t* dev)
+{
+  config_map_t* map = server_conf_map (self, dev->name);
+
+  if (!sched_calibrate (&self->sched, dev - self->devs))
+    {
+      eprintf ("%s", "The device queue is full");
+      return;
+    }
+
+  map->calibrated = 0;
+  map->n_pairs = 0;
+  dev->rounded = false;
+  dev->calibrating = 0;
+  dev->overflow = false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_calibrated (server_t* self, server_device_t* dev, int lost)
+{
+  config_map_t* map = server_conf_map (self, dev->name);
+
+  // A device that took every value needs no map, neither does the one
+  // with more values than the map holds, or the pass that lost some of
+  // its samples. The rounded targets of those are still learned during
+  // the normal use.
+  if (dev->calibrating > 0 && !dev->overflow && lost == 0)
+    map->calibrated = 1;
+  else
+    map->n_pairs = 0;
+
+  dev->rounded = (map->n_pairs > 0);
+  dev->calibrating = -1;
+  dev->target = -1;
+  server_touch (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_flush (server_t* self)
+{
+  int size = sizeof (self->conf);
+  int fd;
+
+  if (!self->dirty)
+    return true;
+
+  switch (fd = creat (self->config, 00664))
+    {
+    default:
+      if (write (fd, &self->conf, size) == size)
+        {
+          set_fd (fd, -1);
+          self->dirty = false;
+          return true;
+        }
+      set_fd (fd, -1);
+      /* no break */
+    case -1:
+      eprintf ("%s: %s", self->config, strerror (errno));
+      self->flush_at = latency_now () + FLUSH_DELAY * 1000000LL;
+    }
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_load (server_t* self, field_t field)
+{
+  config_t conf = *server_conf (self);
+  server_device_t* dev;
+
+  if (conf.minimal < 0)
+    conf.minimal = statics_defaults[DEFAULT_MINIMAL].v_int;
+
+  if (conf.num_levels < 0)
+    conf.num_levels = statics_defaults[DEFAULT_NUM_LEVELS].v_int;
+
+  if (conf.transition < 0)
+    conf.transition = statics_defaults[DEFAULT_TRANSITION].v_int;
+
+  switch (field)
+    {
+    default:
+      return false;
+
+    case FIELD_NONE:
+
+    case FIELD_MINIMAL:
+    case FIELD_NUM_LEVELS:
+      self->minimal = conf.minimal;
+      self->num_levels = conf.num_levels;
+      server_map_levels (self);
+
+      if (field != FIELD_NONE)
+        break;
+      /* no break */
+
+    case FIELD_DEVNAME:
+      if (!server_attach (self))
+        return false;
+      else if (field != FIELD_NONE)
+        break;
+      /* no break */
+
+    case FIELD_SAVED:
+      for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+        if (dev->name)
+          server_load_level (self, dev);
+
+      if (field != FIELD_NONE)
+        break;
+      /* no break */
+
+    case FIELD_LINKED:
+      self->linked = (conf.linked > 0);
+
+      if (field != FIELD_NONE)
+        break;
+      /* no break */
+
+    case FIELD_FADE_BLANK:
+      self->fade_blank = (conf.fade_blank > 0);
+
+      if (field != FIELD_NONE)
+        break;
+      /* no break */
+
+    case FIELD_TRANSITION:
+      self->transition = conf.transition;
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_load_level (server_t* self, server_device_t* dev)
+{
+  config_device_t* entry = server_conf_device (self, dev->name);
+  int saved = entry->level;
+
+  // The level of the single device of the older versions is the best
+  // guess for a device seen for the first time.
+  if (saved < 0)
+    saved = server_conf (self)->saved_level;
+
+  if (saved >= 0 && saved < dev->levels.num_levels)
+    dev->level = saved;
+  else
+    dev->level = dev->levels.num_levels >> 1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The running server holds a write lock on its PID file. The lock belongs
+// to the open file, so it is gone together with the process however that
+// ends, and a file left by a crash tells nothing.
+static int
+server_is_running (server_t* self)
+{
+  struct flock fl = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+  int pid = 0, fd;
+
+  if ((fd = open (self->pidfile, O_RDONLY | O_CLOEXEC)) < 0)
+    return 0;
+
+  // The PID may be not written yet by the server that has just started.
+  if (fcntl (fd, F_OFD_GETLK, &fl) == 0 && fl.l_type != F_UNLCK)
+    pid = MAX (fs_getint (fd), 1);
+
+  set_fd (fd, -1);
+
+  return pid;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_lock (server_t* self)
+{
+  struct flock fl = { .l_type = F_WRLCK, .l_whence = SEEK_SET };
+  int fd, rc;
+
+  if ((fd = open (self->pidfile, O_RDWR | O_CREAT | O_CLOEXEC, 00664)) < 0)
+    return -1;
+
+  if (fcntl (fd, F_OFD_SETLK, &fl) < 0 || ftruncate (fd, 0) < 0)
+    {
+      rc = errno;
+      set_fd (fd, -1);
+      errno = rc;
+      return -1;
+    }
+
+  fs_setint (fd, getpid ());
+
+  return fd;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_reexec (server_t* self)
+{
+  if (!self->handover || !handover_pass (self->handover))
     {
-      eprintf ("The server is already running and has an PID: %d\n", pid);
+      eprintf ("Failed to restart: %s", strerror (errno));
       return false;
     }
 
+  // The daemon() has changed the directory, a relative argv[0] would not
+  // be found from there.
+  execv ("/proc/self/exe", self->argv);
+  execvp (self->argv[0], self->argv);
+  eprintf ("Failed to restart: %s", strerror (errno));
+  handover_cancel (self->handover);
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_handover (server_t* self, struct pollfd* clients, struct pollfd* end,
+                 struct ucred const* peers)
+{
+  handover_t* ho;
+  handover_client_t* cl;
+  handover_device_t* hd;
+  server_device_t* dev;
+  struct pollfd* it;
+  int i;
+
+  if (!(self->handover = ho = calloc (1, sizeof (*ho))))
+    return;
+
+  ho->socket = self->socket;
+  ho->dgram = self->dgram;
+  ho->lock = self->lock;
+  ho->activated = self->activated;
+
+  // The connections are served by the next image, the one that asked for
+  // the restart is answered by it.
+  for (it = clients; it < end && ho->n_clients < HANDOVER_MAX_CLIENTS; it++)
+    {
+      if (it->fd < 0)
+        continue;
+
+      cl = ho->clients + ho->n_clients++;
+      cl->fd = it->fd;
+      cl->uid = peers[it - clients].uid;
+      cl->pid = peers[it - clients].pid;
+      cl->closing = (it->fd == self->requester
+                     || watch_has (&self->watch, it->fd)
+                     || server_is_waiting (self, it->fd));
+      it->fd = -1;
+    }
+
+  for (dev = self->devs, hd = ho->devs, i = 0; i < SCHED_MAX_DEVICES;
+       dev++, hd++, i++)
+    {
+      if (!dev->name)
+        continue;
+
+      snprintf (hd->name, sizeof (hd->name), "%s", dev->name);
+      hd->level = dev->level;
+      hd->target = dev->target;
+      hd->blanked = dev->blanked;
+      hd->remaining = sched_remaining (&self->sched, i);
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_adopt (server_t* self, struct pollfd* clients, struct ucred* peers)
+{
+  handover_t* ho = self->handover;
+  handover_client_t* cl;
+  handover_device_t* hd;
+  server_device_t* dev;
+  int target, n = 0;
+
+  if (!ho)
+    return;
+
+  for (cl = ho->clients; cl < ho->clients + ho->n_clients; cl++)
+    if (!cl->closing && n < MAX_POLL_SIZE - POLL_CLIENTS)
+      {
+        clients[n].fd = cl->fd;
+        peers[n].uid = cl->uid;
+        peers[n].pid = cl->pid;
+        cl->fd = -1;
+        n++;
+      }
+
+  // A transition goes on from where the previous image has left the
+  // device, in the time that was left of it.
+  for (hd = ho->devs; hd < ho->devs + SCHED_MAX_DEVICES; hd++)
+    {
+      hd->name[sizeof (hd->name) - 1] = 0;
+
+      if (!*hd->name || !(dev = server_find (self, hd->name)))
+        continue;
+
+      if (hd->level < dev->levels.num_levels)
+        dev->level = hd->level;
+
+      dev->blanked = hd->blanked;
+      target = server_target (self, dev);
+
+      if (hd->remaining > 0 && target == hd->target
+          && sched_set_target (&self->sched, dev - self->devs, target,
+                               hd->remaining, self->linked))
+        dev->target = target;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_release (server_t* self)
+{
+  handover_client_t* cl;
+
+  if (!self->handover)
+    return;
+
+  // The client that asked for the restart learns that it is over when
+  // its connection is closed.
+  for (cl = self->handover->clients;
+       cl < self->handover->clients + self->handover->n_clients; cl++)
+    if (cl->fd >= 0)
+      close (cl->fd);
+
+  ckfree (self->handover);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_activated (int* dgram)
+{
+  char const* pid = getenv ("LISTEN_PID");
+  char const* fds = getenv ("LISTEN_FDS");
+  int fd, n, type, sock = -1;
+  socklen_t len;
+
+  // The sockets bound by the service manager, they are passed as
+  // described in sd_listen_fds(3). The first stream socket takes the
+  // connections, the first datagram one the hotkeys.
+  if (!pid || !fds || atoi (pid) != getpid () || (n = atoi (fds)) < 1)
+    return -1;
+
+  unsetenv ("LISTEN_PID");
+  unsetenv ("LISTEN_FDS");
+  unsetenv ("LISTEN_FDNAMES");
+
+  for (fd = LISTEN_FDS_START; fd < LISTEN_FDS_START + n; fd++)
+    {
+      len = sizeof (type);
+
+      if (getsockopt (fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0)
+        continue;
+      else if (type == SOCK_STREAM && sock < 0)
+        sock = fd;
+      else if (type == SOCK_DGRAM && *dgram < 0)
+        *dgram = fd;
+      else
+        continue;
+
+      fcntl (fd, F_SETFD, FD_CLOEXEC);
+    }
+
+  if (sock < 0)
+    eprintf ("%s", "The passed socket is not a stream socket");
+
+  return sock;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_prepare (server_t* self)
+{
+  char* path;
+
+  context_spw_init ((context_t*) self);
+
   if (!fs_make_path (self->workdir, 0))
     {
       eprintf ("%s", strerror (errno));
       return false;
     }
 
-  if (!server_load (self, FIELD_NONE))
-    return false;
+  if (self->lock < 0 && (self->lock = server_lock (self)) < 0)
+    {
+      if (errno == EAGAIN || errno == EACCES)
+        eprintf ("The server is already running and has an PID: %d",
+                 server_is_running (self));
+      else
+        eprintf ("%s: %s", self->pidfile, strerror (errno));
+
+      return false;
+    }
+
+  // The readers of the page do not need the server, so the server does
+  // not need the page either.
+  path = fs_path_join (self->workdir, statics_defaults[DEFAULT_STATUS].v_str,
+                       null);
+
+  if (!(self->page = statpage_create (path)))
+    eprintf ("%s: %s", path, strerror (errno));
+
+  self->sched.page = self->page;
+  ckfree (path);
+
+  if (!server_load (self, FIELD_NONE))
+    return false;
+
+  // The commands are taken by the stream socket alone when the datagram
+  // one can not be bound.
+  if (self->dgram < 0 && !server_open_dgram (self))
+    eprintf ("The datagram socket is not available: %s", strerror (errno));
+
+  // The socket of the service manager or of the previous image.
+  if (self->socket >= 0)
+    return true;
+
+  // Only the owner of the lock gets here, so the file can not belong to
+  // another server. An abstract socket has no file at all.
+  if (fs_socket_is_abstract (self->socketname))
+    {
+      if ((self->socket
+           = fs_open_socket (self->socketname, (sock_func_t) bind)) >= 0)
+        return true;
+
+      eprintf ("%s: %s", self->socketname, strerror (errno));
+      return false;
+    }
+
+  unlink (self->socketname);
+
+  switch (self->socket = fs_open_socket (self->socketname, (sock_func_t) bind))
+    {
+    default:
+      if (chmod (self->socketname, 00666) == 0)
+        return true;
+      /* no break */
+    case -1:
+      eprintf ("%s", strerror (errno));
+      set_fd (self->socket, -1);
+      unlink (self->socketname);
+    }
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static char*
+server_dgram_path (server_t* self)
+{
+  return fs_stringf ("%s" DGRAM_SUFFIX, self->socketname);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_open_dgram (server_t* self)
+{
+  char* path = server_dgram_path (self);
+  int rc;
+
+  // The socket takes the hotkeys of any user, like the stream one.
+  if (!fs_socket_is_abstract (path))
+    unlink (path);
+
+  if ((self->dgram = fs_open_socket_type (path, SOCK_DGRAM, (sock_func_t) bind))
+          >= 0
+      && (fs_socket_is_abstract (path) || chmod (path, 00666) == 0))
+    {
+      ckfree (path);
+      return true;
+    }
+
+  rc = errno;
+  set_fd (self->dgram, -1);
+  ckfree (path);
+  errno = rc;
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_level_value (server_t* self, server_device_t* dev, int level)
+{
+  return server_snap (self, dev, levels_value (&dev->levels, level));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+server_target (server_t* self, server_device_t* dev)
+{
+  if (dev->level < 0 || (dev->blanked && self->fade_blank))
+    return server_snap (self, dev, 0);
+
+  return server_level_value (self, dev, dev->level);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_retarget (server_t* self)
+{
+  server_retarget_with (self, self->transition);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_retarget_with (server_t* self, int transition)
+{
+  server_device_t* dev;
+  int i, target, power;
+
+  for (dev = self->devs, i = 0; i < SCHED_MAX_DEVICES; dev++, i++)
+    {
+      if (!dev->name)
+        continue;
+
+      power = dev->blanked ? BL_POWER_OFF : BL_POWER_ON;
+
+      // The display is powered before it fades in...
+      if (dev->power >= 0 && dev->power != power && power == BL_POWER_ON
+          && sched_set_power (&self->sched, i, power, false))
+        dev->power = power;
+
+      target = server_target (self, dev);
+
+      // The linked devices form a single group and fade in lockstep.
+      if (target != dev->target)
+        {
+          if (sched_set_target (&self->sched, i, target, transition,
+                                self->linked))
+            {
+              dev->target = target;
+              dev->moving = true;
+              server_notify (self, dev, WATCH_TARGET, target);
+            }
+          else
+            eprintf ("%s", "The device queue is full");
+        }
+
+      // ...and its power is cut after it fades out.
+      if (dev->power >= 0 && dev->power != power && power == BL_POWER_OFF
+          && sched_set_power (&self->sched, i, power, self->fade_blank))
+        dev->power = power;
+    }
+
+  sched_commit (&self->sched);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_status (server_t* self)
+{
+  char status[STRSIZE];
+  server_device_t* first = null;
+  server_device_t* dev;
+  int n = 0;
+
+  server_publish (self);
+
+  if (self->notify.fd < 0)
+    return;
+
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    if (dev->name && !n++)
+      first = dev;
+
+  if (!first)
+    snprintf (status, sizeof (status), "%s", "No devices");
+  else if (first->blanked || first->level < 0)
+    snprintf (status, sizeof (status), "%s: off", first->name);
+  else
+    snprintf (status, sizeof (status), "%s: level %d/%d", first->name,
+              first->level, first->levels.num_levels);
+
+  if (n > 1)
+    snprintf (status + strlen (status), sizeof (status) - strlen (status),
+              " (%d devices)", n);
+
+  notify_status (&self->notify, status);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_publish (server_t* self)
+{
+  statpage_device_t* out;
+  server_device_t* dev;
+  int n = 0;
+
+  if (!self->page)
+    return;
+
+  // The brightness and the progress are published by the device thread.
+  statpage_begin (self->page);
+
+  for (dev = self->devs, out = self->page->devs;
+       dev < self->devs + SCHED_MAX_DEVICES; dev++, out++)
+    {
+      if (!dev->name)
+        {
+          *out->name = 0;
+          continue;
+        }
+
+      snprintf (out->name, sizeof (out->name), "%s", dev->name);
+      out->max = dev->max;
+      out->level = dev->level;
+      out->num_levels = dev->levels.num_levels;
+      out->blanked = dev->blanked;
+      n = dev - self->devs + 1;
+    }
+
+  self->page->n_devs = n;
+  statpage_end (self->page);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_events (server_t* self)
+{
+  sched_event_t ev;
+  server_device_t* dev;
+  device_info_t* info;
+  bool_t retarget = false;
+
+  ring_ack (&self->sched.events);
+  self->active_at = latency_boottime ();
+
+  while (sched_pop_event (&self->sched, &ev))
+    {
+      if (!(dev = self->devs + ev.device)->name)
+        continue;
+
+      switch (ev.type)
+        {
+        case SCHED_EVENT_SAMPLE:
+          if (dev->calibrating < 0)
+            break;
+
+          dev->calibrating += (ev.value != ev.written);
+          server_learn (self, dev, ev.written, ev.value);
+          break;
+
+        case SCHED_EVENT_CALIBRATED:
+          if (dev->calibrating >= 0)
+            server_calibrated (self, dev, ev.written);
+
+          retarget = true;
+          break;
+
+        case SCHED_EVENT_CHANGED:
+          server_resync (self, dev, ev.value);
+
+          if ((info = inventory_find (&self->inventory, dev->name)))
+            info->current = ev.value;
+
+          dev->moving = false;
+          server_notify (self, dev, WATCH_DONE, ev.value);
+          break;
+
+        case SCHED_EVENT_VALUE:
+          server_notify (self, dev, WATCH_VALUE, ev.value);
+          break;
+
+        case SCHED_EVENT_PROBED:
+          server_probed (self, dev, ev.value, ev.written);
+          break;
+
+        case SCHED_EVENT_ROUNDED:
+          // The next transition to the same target ends where this one
+          // did, without another write.
+          if (dev->calibrating < 0)
+            server_learn (self, dev, ev.written, ev.value);
+          /* fall through */
+
+        case SCHED_EVENT_DONE:
+          // Only the completion of the latest target is worth saving, the
+          // older ones were already overridden by the clients.
+          if (ev.written == dev->target && dev->level >= 0)
+            server_save_level (self, dev);
+          /* fall through */
+
+        case SCHED_EVENT_STALLED:
+          if ((info = inventory_find (&self->inventory, dev->name)))
+            info->current = ev.value;
+
+          // An older target may end after a newer one is already sent.
+          if (ev.written == dev->target && dev->moving)
+            {
+              dev->moving = false;
+              server_notify (self, dev, WATCH_DONE, ev.value);
+            }
+
+          // The resume is over once all of the devices are restored, the
+          // other writes do not count.
+          if (dev->waking && ev.written == dev->target)
+            {
+              dev->waking = false;
+
+              if (self->waking > 0 && --self->waking == 0)
+                latency_add (&self->resume, self->woke_at);
+            }
+        }
+    }
+
+  // The device is driven to its target again after a calibration pass.
+  if (retarget)
+    server_retarget (self);
+
+  server_status (self);
+  server_answer (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_resync (server_t* self, server_device_t* dev, int value)
+{
+  // The device was changed by someone else, the nearest level becomes
+  // the current one and its target is taken as reached, so the device
+  // is left where it is until the next command.
+  dev->level = levels_nearest (&dev->levels, value);
+  dev->target = server_target (self, dev);
+  server_save_level (self, dev);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline void
+server_event (server_device_t const* dev, watch_event_t* ev,
+              watch_type_t type, int value)
+{
+  memset (ev, 0, sizeof (*ev));
+  ev->type = type;
+  ev->value = value;
+  ev->target = dev->target;
+  ev->max = dev->max;
+  ev->level = dev->blanked ? -1 : dev->level;
+  snprintf (ev->device, sizeof (ev->device), "%s", dev->name);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_notify (server_t* self, server_device_t* dev, watch_type_t type,
+               int value)
+{
+  watch_event_t ev;
+
+  if (self->watch.n_subs == 0)
+    return;
+
+  server_event (dev, &ev, type, value);
+  watch_send (&self->watch, dev - self->devs, &ev);
+
+  // The steps are sent by the device thread only while they are wanted.
+  sched_set_values (&self->sched, self->watch.n_values > 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_greet (server_t* self, int fd)
+{
+  statpage_device_t devs[SCHED_MAX_DEVICES];
+  server_device_t* dev;
+  watch_event_t ev;
+  int i, n;
+
+  // The current brightness is known to the device thread only, it is
+  // taken from the status page.
+  n = self->page ? statpage_read (self->page, devs, SCHED_MAX_DEVICES) : -1;
+
+  for (dev = self->devs, i = 0; i < SCHED_MAX_DEVICES; dev++, i++)
+    {
+      if (!dev->name)
+        continue;
+
+      server_event (dev, &ev, WATCH_ADDED, i < n ? devs[i].value : -1);
+      watch_send_to (&self->watch, fd, i, &ev);
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_hold (server_t* self, int fd, message_t const* msg)
+{
+  server_waiter_t* it;
+
+  // A command that has started nothing is answered at once, as well as
+  // the one that finds no room to wait.
+  if (!server_is_moving (self, msg->device)
+      || self->n_waiters >= SERVER_MAX_WAITERS)
+    return false;
+
+  it = self->waiters + self->n_waiters++;
+  it->fd = fd;
+  it->msg = *msg;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_answer (server_t* self)
+{
+  server_waiter_t* it;
+
+  for (it = self->waiters; it < self->waiters + self->n_waiters;)
+    {
+      if (server_is_moving (self, it->msg.device))
+        {
+          it++;
+          continue;
+        }
+
+      reply (it->fd, &it->msg, sizeof (it->msg));
+      *it = self->waiters[--self->n_waiters];
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_interrupt (server_t* self, char const* error)
+{
+  server_waiter_t* it;
+
+  // The transitions the commands wait for will not end, the commands
+  // fail instead of waiting for an unrelated event.
+  for (it = self->waiters; it < self->waiters + self->n_waiters; it++)
+    {
+      it->msg.type = TYPE_ERROR;
+      _seterrf (it->msg.v_str, "%s", error);
+      reply (it->fd, &it->msg, sizeof (it->msg));
+    }
+
+  self->n_waiters = 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_hotplug (server_t* self)
+{
+  uevent_t ev;
+  char name[sizeof (ev.name) + sizeof (LEDS_PREFIX)];
+  char replugged[HOTPLUG_BATCH][sizeof (name)];
+  server_device_t* dev;
+  bool_t all = false;
+  int i, n = 0;
+
+  while (uevent_receive (self->uevent, &ev))
+    {
+      if (ev.action == UEVENT_OVERFLOW)
+        {
+          inventory_invalidate (&self->inventory);
+          all = true;
+          continue;
+        }
+      else if (!*ev.name)
+        continue;
+      else if (strcmp (ev.subsystem, "backlight") == 0)
+        snprintf (name, sizeof (name), "%s", ev.name);
+      else if (strcmp (ev.subsystem, "leds") == 0)
+        snprintf (name, sizeof (name), LEDS_PREFIX "%s", ev.name);
+      else
+        continue;
+
+      if (ev.action == UEVENT_ADD || ev.action == UEVENT_CHANGE)
+        inventory_add (&self->inventory, name);
+      else if (ev.action == UEVENT_REMOVE)
+        inventory_remove (&self->inventory, name);
+
+      // A device that came and went is another node under the same name.
+      if (ev.action != UEVENT_ADD && ev.action != UEVENT_REMOVE)
+        continue;
+      else if (n < HOTPLUG_BATCH)
+        memcpy (replugged[n++], name, sizeof (name));
+      else
+        all = true;
+    }
+
+  // The devices chosen by the user are taken back as soon as they appear
+  // again, the gone ones are replaced.
+  server_attach (self);
+
+  // The ones that are still attached after a remove or an add hold the
+  // descriptors of the old node, they are opened again.
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    {
+      if (!dev->name)
+        continue;
+
+      for (i = 0; !all && i < n && strcmp (dev->name, replugged[i]); i++)
+        ;
+
+      if (!all && i == n)
+        continue;
+
+      snprintf (name, sizeof (name), "%s", dev->name);
+      server_unset_device (self, dev - self->devs);
+      server_set_device (self, dev - self->devs, name);
+    }
+
+  server_retarget (self);
+  server_status (self);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_open_ring (server_t* self)
+{
+  if (!(self->ring = cmdring_create (&self->ring_fd)))
+    return false;
+
+  if ((self->ring_wake = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) >= 0)
+    return true;
+
+  cmdring_destroy (self->ring);
+  self->ring = null;
+  set_fd (self->ring_fd, -1);
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline bool_t
+server_is_hotkey (int field)
+{
+  switch (field)
+    {
+    case FIELD_INC:
+    case FIELD_DEC:
+    case FIELD_ON:
+    case FIELD_OFF:
+    case FIELD_SWITCH:
+    case FIELD_SET:
+      return true;
+    default:
+      return false;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_drain (server_t* self)
+{
+  message_t msg = MESSAGE_INIT;
+  long long now = latency_now ();
+  cmdring_cmd_t cmd;
+  uint64_t count;
+  int n = 0;
+
+  // The counter is reset before the ring is read, a command pushed after
+  // that wakes the loop again.
+  if (read (self->ring_wake, &count, sizeof (count)) < 0 && errno != EAGAIN)
+    eprintf ("%s", strerror (errno));
+
+  while (cmdring_pop (self->ring, &cmd))
+    {
+      // The stamp comes from a client, it is not trusted too much.
+      cmd.stamp = (cmd.stamp > 0 && cmd.stamp <= now) ? cmd.stamp : now;
+      cmd.device[sizeof (cmd.device) - 1] = 0;
+      latency_add_ns (&self->ring_delay, now - cmd.stamp);
+
+      if (!server_is_hotkey (cmd.field)
+          || (*cmd.device && !server_find (self, cmd.device)))
+        continue;
+
+      // The batch is measured from its oldest command.
+      if (!n++)
+        sched_set_origin (&self->sched, cmd.stamp);
+
+      msg.field = cmd.field;
+      msg.v_int = cmd.value;
+      memcpy (msg.device, cmd.device, sizeof (msg.device));
+      server_command (self, &msg);
+    }
+
+  if (n == 0)
+    return;
+
+  server_retarget (self);
+  server_status (self);
+  self->active_at = latency_boottime ();
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline struct ucred const*
+dgram_sender (struct msghdr* hdr)
+{
+  struct cmsghdr* cmsg;
+
+  for (cmsg = CMSG_FIRSTHDR (hdr); cmsg; cmsg = CMSG_NXTHDR (hdr, cmsg))
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_CREDENTIALS)
+      return (struct ucred const*) CMSG_DATA (cmsg);
+
+  return null;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_receive (server_t* self)
+{
+  char ctls[DGRAM_BATCH][CMSG_SPACE (sizeof (struct ucred))]
+      __attribute__ ((aligned (sizeof (size_t))));
+  struct mmsghdr hdrs[DGRAM_BATCH];
+  struct iovec iovs[DGRAM_BATCH];
+  message_t msgs[DGRAM_BATCH];
+  struct ucred const* peer;
+  message_t* msg;
+  long long start = latency_now ();
+  int i, n, count = 0;
+
+  // The datagrams queued since the last wakeup are taken in batches, the
+  // devices are retargeted once for all of them. There is no answer.
+  do
+    {
+      for (i = 0; i < DGRAM_BATCH; i++)
+        {
+          iovs[i].iov_base = msgs + i;
+          iovs[i].iov_len = sizeof (*msgs);
+          memset (&hdrs[i].msg_hdr, 0, sizeof (hdrs[i].msg_hdr));
+          hdrs[i].msg_hdr.msg_iov = iovs + i;
+          hdrs[i].msg_hdr.msg_iovlen = 1;
+          hdrs[i].msg_hdr.msg_control = ctls[i];
+          hdrs[i].msg_hdr.msg_controllen = sizeof (ctls[i]);
+        }
+
+      if ((n = recvmmsg (self->dgram, hdrs, DGRAM_BATCH, MSG_DONTWAIT, null))
+          < 0)
+        {
+          if (errno != EAGAIN && errno != EINTR)
+            eprintf ("%s", strerror (errno));
+          break;
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          msg = msgs + i;
+          msg->device[sizeof (msg->device) - 1] = 0;
+
+          if (hdrs[i].msg_len != sizeof (*msg)
+              || !(peer = dgram_sender (&hdrs[i].msg_hdr))
+              || !admission_check (&self->admission, peer->uid, peer->pid)
+              || !server_is_hotkey (msg->field)
+              || (*msg->device && !server_find (self, msg->device)))
+            continue;
+
+          if (!count++)
+            sched_set_origin (&self->sched, start);
+
+          server_command (self, msg);
+        }
+    }
+  while (n == DGRAM_BATCH);
+
+  if (count == 0)
+    return;
+
+  server_retarget (self);
+  server_status (self);
+  latency_add (&self->receive, start);
+  self->active_at = latency_boottime ();
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline void
+accept_connection (int sock, struct pollfd* start, struct pollfd* end,
+                   struct ucred* peers, server_line_t* lines)
+{
+  struct pollfd* it;
+  socklen_t len = sizeof (*peers);
+
+  for (it = start; it < end && it->fd >= 0; it++)
+    ;
+
+  if (it >= end || (it->fd = accept4 (sock, null, null, SOCK_CLOEXEC)) < 0)
+    return;
+
+  peers += it - start;
+  lines[it - start].len = 0;
+
+  if (getsockopt (it->fd, SOL_SOCKET, SO_PEERCRED, peers, &len) < 0)
+    {
+      peers->uid = (uid_t) -1;
+      peers->pid = 0;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_disconnect (server_t* self, struct pollfd* ps)
+{
+  server_waiter_t* it;
+
+  watch_remove (&self->watch, ps->fd);
+  sched_set_values (&self->sched, self->watch.n_values > 0);
+
+  for (it = self->waiters; it < self->waiters + self->n_waiters;)
+    {
+      if (it->fd == ps->fd)
+        *it = self->waiters[--self->n_waiters];
+      else
+        it++;
+    }
+
+  set_fd (ps->fd, -1);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_is_private (field_t field)
+{
+  // The commands that stop or reconfigure the server itself, the rate
+  // limit among them, and the ring that is not rate limited are for root
+  // and the owner of the server only.
+  switch (field)
+    {
+    case FIELD_STOP:
+    case FIELD_RESTART:
+    case FIELD_RING:
+    case FIELD_RATE_LIMIT:
+    case FIELD_IDLE_EXIT:
+    case FIELD_RESTORE:
+    case FIELD_WORKDIR:
+    case FIELD_PIDFILE:
+    case FIELD_SOCKNAME:
+    case FIELD_CONFIG:
+    case FIELD_DAEMON:
+      return true;
+
+    default:
+      return false;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_dispatch (server_t* self, int fd, struct ucred const* peer,
+                 server_message_t* smsg, bool_t text, long long start)
+{
+  message_t* msg = &smsg->msg;
+  bool_t done = true, answered = false;
+
+  if (msg->type == TYPE_ERROR)
+    done = false;
+  else if (!admission_check (&self->admission, peer->uid, peer->pid))
+    {
+      _seterrf (msg->v_str, "Too many requests from uid %d, try again later",
+                (int) peer->uid);
+      msg->type = TYPE_ERROR;
+    }
+  else if (server_is_private (msg->field) && peer->uid != 0
+           && peer->uid != geteuid ())
+    {
+      _seterrf (msg->v_str, "%s", "Only the owner may do this");
+      msg->type = TYPE_ERROR;
+    }
+  else if ((msg->device[sizeof (msg->device) - 1] = 0, *msg->device)
+           && !server_find (self, msg->device))
+    {
+      _seterrf (msg->v_str, "Unknown device '%s'", msg->device);
+      msg->type = TYPE_ERROR;
+    }
+  else if (text && msg->field == FIELD_RING)
+    {
+      _seterrf (msg->v_str, "%s", "The ring is not passed as text");
+      msg->type = TYPE_ERROR;
+    }
+  else
+    {
+      smsg->socket = fd;
+      g_text_socket = text ? fd : -1;
+      g_reply_socket = fd;
+      g_answered = false;
+      sched_set_origin (&self->sched, start);
+      done = context_perform ((context_t*) self, msg);
+      answered = g_answered;
+      g_text_socket = -1;
+      g_reply_socket = -1;
+      server_retarget (self);
+      server_status (self);
+    }
+
+  // A line is answered with OK or with the error, the binary message is
+  // echoed unless the callback has answered it. A command sent with --wait
+  // is answered when its transitions are over.
+  if (text && msg->type != TYPE_ERROR && !done)
+    {
+      _seterrf (msg->v_str, "%s", "Bad command");
+      msg->type = TYPE_ERROR;
+    }
+
+  if (text)
+    reply_line (fd, msg->type == TYPE_ERROR ? msg->v_str : "OK");
+  else if (!answered
+           && (msg->type == TYPE_ERROR || !msg->wait
+               || !server_hold (self, fd, msg)))
+    reply (fd, msg, sizeof (*msg));
+
+  // The subscriber learns the current state right after the answer.
+  if (msg->type != TYPE_ERROR && msg->field == FIELD_WATCH
+      && watch_has (&self->watch, fd))
+    server_greet (self, fd);
 
-  unlink (self->socketname);
+  latency_add (&self->handle, start);
 
-  switch (self->socket = fs_open_socket (self->socketname, (sock_func_t) bind))
+  self->active_at = latency_boottime ();
+
+  // With socket activation the first client waits for the whole start of
+  // the server, which is expected to stay short.
+  if (self->activated && !self->first.count)
     {
-    default:
-      if (chmod (self->socketname, 00666) == 0)
-        return true;
-      /* no break */
-    case -1:
-      eprintf ("%s", strerror (errno));
-      set_fd (self->socket, -1);
-      unlink (self->socketname);
-    }
+      latency_add (&self->first, self->started_at);
 
-  return false;
+      if (self->first.max > FIRST_REPLY_BUDGET * 1000000LL)
+        eprintf ("The first reply took %lld ms",
+                 (long long) self->first.max / 1000000);
+    }
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static void
-server_adjust (server_t* self)
+handle_text (server_t* self, struct pollfd* ps, struct ucred const* peer,
+             server_line_t* line)
 {
-  int target, newv, current, diff, step;
+  server_message_t smsg;
+  long long start = latency_now ();
+  char* eol;
+  int used;
+
+  // Each complete line is a command, the rest waits for its end.
+  while (!g_total_quit && ps->fd >= 0
+         && (eol = memchr (line->buf, '\n', line->len)))
+    {
+      *eol = 0;
+      used = eol + 1 - line->buf;
 
-  if (self->level >= 0)
-    target = self->level_size * (float) self->level + self->minimal;
-  else
-    target = 0;
+      if (line->buf[strspn (line->buf, " \t\r")])
+        {
+          smsg = (server_message_t){ MESSAGE_INIT, -1 };
 
-  target = MIN (target, self->dev.max);
+          if (!message_parse (line->buf, &smsg.msg))
+            smsg.msg.type = TYPE_ERROR;
 
-  if (self->transition <= POLL_TIMEOUT)
-    {
-      if (server_device_set (self, target))
-        self->timeout = POLL_TIMEOUT;
-      else
-        self->timeout = POLL_TIMEOUT_WAIT;
-    }
-  else if ((current = server_device_get (self)) != target)
-    {
-      diff = target - current;
-      step = fround (self->level_size / (float) MAX (self->transition, 1.0)
-                     * diff);
-      newv = (diff < 0) ? MAX (current + MIN (step, -1), target)
-                        : MIN (current + MAX (step, 1), target);
+          server_dispatch (self, ps->fd, peer, &smsg, true, start);
+        }
 
-      if (server_device_set (self, newv))
-        self->timeout = POLL_TIMEOUT;
-      else
-        self->timeout = POLL_TIMEOUT_WAIT;
+      memmove (line->buf, line->buf + used, line->len - used);
+      line->len -= used;
     }
-  else
+
+  if (line->len >= (int) sizeof (line->buf))
     {
-      if (self->level >= 0)
-        server_save (self, FIELD_SAVED);
-      self->timeout = POLL_TIMEOUT_WAIT;
+      reply_line (ps->fd, "ERROR: The line is too long");
+      line->len = 0;
     }
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static inline void
-accept_connection (int sock, struct pollfd* start, struct pollfd* end)
-{
-  for (; start < end && start->fd >= 0; start++)
-    ;
-
-  if (start < end)
-    start->fd = accept (sock, null, null);
-}
-//------------------------------------------------------------------------------
-//------------------------------------------------------------------------------
-static inline void
-handle_message (server_t* self, struct pollfd* ps)
+handle_message (server_t* self, struct pollfd* ps, struct ucred const* peer,
+                server_line_t* line)
 {
   server_message_t smsg = { MESSAGE_INIT, -1 };
   message_t* msg = (message_t*) &smsg;
   int size = sizeof (smsg.msg);
+  long long start = latency_now ();
+  char* dest = (char*) msg;
   int rc;
 
-  if ((rc = recv (ps->fd, msg, size, 0)) < 0)
+  // A line of the text protocol starts with a letter, a binary message
+  // with its field. The rest of an unfinished line is text anyway.
+  if (line->len > 0)
+    {
+      dest = line->buf + line->len;
+      size = sizeof (line->buf) - line->len;
+    }
+
+  if ((rc = recv (ps->fd, dest, size, 0)) == 0)
+    {
+      server_disconnect (self, ps);
+      return;
+    }
+  else if (rc > 0 && (line->len > 0 || isalpha ((unsigned char) *dest)))
+    {
+      if (dest != line->buf + line->len)
+        memcpy (line->buf + line->len, dest, rc);
+
+      line->len += rc;
+      handle_text (self, ps, peer, line);
+      return;
+    }
+  else if (rc < 0)
     {
       seterrf (msg->v_str, "Failed to receive message:%s", strerror (errno));
       msg->type = TYPE_ERROR;
@@ -517,13 +2299,32 @@ handle_message (server_t* self, struct pollfd* ps)
       seterrf (msg->v_str, "%s", "Received a broken message");
       msg->type = TYPE_ERROR;
     }
-  else
-    {
-      smsg.socket = ps->fd;
-      context_perform ((context_t*) self, msg);
-    }
 
-  reply (ps->fd, msg, size);
+  server_dispatch (self, ps->fd, peer, &smsg, false, start);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static inline long long
+idle_deadline (server_t* self, struct pollfd const* clients,
+               struct pollfd const* end)
+{
+  struct pollfd const* it;
+
+  // Only the server started by the service manager may go away, the next
+  // client starts it again. A connected client or a running transition
+  // keeps it.
+  if (!self->activated || self->idle_exit <= 0)
+    return -1;
+
+  for (it = clients; it < end; it++)
+    if (it->fd >= 0)
+      return -1;
+
+  // The idle time counts the sleep of the system too, the deadline is
+  // moved to the clock of the poll loop.
+  return (self->active_at + self->idle_exit * 1000000000LL
+          + self->transition * 1000000LL - latency_boottime ()
+          + latency_now ());
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
@@ -531,8 +2332,12 @@ static bool_t
 server_start (server_t* self)
 {
   struct pollfd ps[MAX_POLL_SIZE];
+  struct ucred peers[MAX_POLL_SIZE - POLL_CLIENTS];
+  server_line_t lines[MAX_POLL_SIZE - POLL_CLIENTS];
   struct pollfd* psit;
   struct pollfd* psend = ps + MAX_POLL_SIZE;
+  struct pollfd* clients = ps + POLL_CLIENTS;
+  long long timeout, wake_at, idle_at, ring_at;
   int ready;
   int on = 1;
   bool_t result;
@@ -543,6 +2348,12 @@ server_start (server_t* self)
   result = result && (fcntl (self->socket, F_SETFL, O_NONBLOCK) == 0);
   result = result && (listen (self->socket, MAX_POLL_SIZE) == 0);
 
+  // Each datagram comes with the credentials of its sender.
+  if (self->dgram >= 0
+      && setsockopt (self->dgram, SOL_SOCKET, SO_PASSCRED, &on, sizeof (on))
+             < 0)
+    set_fd (self->dgram, -1);
+
   for (psit = ps; psit < psend && result; psit++)
     {
       psit->fd = -1;
@@ -550,13 +2361,61 @@ server_start (server_t* self)
       psit->revents = 0;
     }
 
-  ps->fd = self->socket;
+  for (psit = clients; psit < psend; psit++)
+    lines[psit - clients].len = 0;
+
+  if ((self->uevent = uevent_open ()) < 0)
+    eprintf ("Device hotplug is not available: %s", strerror (errno));
+
+  ps[POLL_SOCKET].fd = self->socket;
+  ps[POLL_EVENTS].fd = ring_fd (&self->sched.events);
+  ps[POLL_UEVENT].fd = self->uevent;
+
+  if (!server_open_ring (self))
+    eprintf ("The command ring is not available: %s", strerror (errno));
+
+  ps[POLL_RING].fd = self->ring_wake;
+  ps[POLL_DGRAM].fd = self->dgram;
+
+  server_adopt (self, clients, peers);
+  server_retarget (self);
+  result = result && sched_start (&self->sched);
+
+  // The clients may come as soon as the service manager learns this.
+  if (result)
+    {
+      char ready[32];
+
+      snprintf (ready, sizeof (ready), "READY=1\nMAINPID=%d", (int) getpid ());
+      notify_send (&self->notify, ready);
+      server_status (self);
+      server_release (self);
+    }
 
   while (result && !g_total_quit)
     {
-      server_adjust (self);
+      // The loop wakes up for the flush, the idle exit or the watchdog,
+      // whichever comes first.
+      if (self->dirty)
+        wake_at = self->flush_at;
+      else
+        wake_at = idle_deadline (self, clients, psend);
+
+      if (wake_at < 0 || (self->notify.ping_at >= 0
+                          && self->notify.ping_at < wake_at))
+        wake_at = self->notify.ping_at;
 
-      switch ((ready = poll (ps, psend - ps, self->timeout)))
+      // A slot of the ring left by a dead client is skipped in time.
+      if (self->ring && (ring_at = cmdring_deadline (self->ring)) >= 0
+          && (wake_at < 0 || ring_at < wake_at))
+        wake_at = ring_at;
+
+      if (wake_at < 0)
+        timeout = -1;
+      else
+        timeout = MAX (0LL, (wake_at - latency_now () + 999999) / 1000000);
+
+      switch ((ready = poll (ps, psend - ps, timeout)))
         {
         case 0:
           break;
@@ -575,23 +2434,60 @@ server_start (server_t* self)
               {
                 if (g_total_quit || ready <= 0)
                   break;
-                else if (psit->revents && psit->fd == self->socket)
-                  accept_connection (self->socket, ps, psend);
+                else if (psit->revents && psit == ps + POLL_SOCKET)
+                  accept_connection (self->socket, clients, psend, peers,
+                                     lines);
+                else if (psit->revents && psit == ps + POLL_EVENTS)
+                  server_events (self);
+                else if (psit->revents & (POLLHUP | POLLERR)
+                         && psit == ps + POLL_UEVENT)
+                  psit->fd = -1;
+                else if (psit->revents && psit == ps + POLL_UEVENT)
+                  server_hotplug (self);
+                else if (psit->revents && psit == ps + POLL_RING)
+                  server_drain (self);
+                else if (psit->revents && psit == ps + POLL_DGRAM)
+                  server_receive (self);
                 else if (psit->revents & POLLHUP)
-                  set_fd (psit->fd, -1);
+                  server_disconnect (self, psit);
                 else if (psit->revents & (POLLIN | POLLPRI))
-                  handle_message (self, psit);
+                  handle_message (self, psit, peers + (psit - clients),
+                                  lines + (psit - clients));
 
                 ready -= (psit->revents != 0);
               }
           }
         }
+
+      // The watchdog is fed only while the loop keeps turning.
+      notify_ping (&self->notify, latency_now ());
+
+      if (self->dirty && latency_now () >= self->flush_at)
+        server_flush (self);
+
+      if (self->ring && (ring_at = cmdring_deadline (self->ring)) >= 0
+          && latency_now () >= ring_at)
+        server_drain (self);
+
+      // The state is saved before the idle server goes away.
+      if (!self->dirty && (idle_at = idle_deadline (self, clients, psend)) >= 0
+          && latency_now () >= idle_at)
+        break;
     }
 
   if (!result && !g_total_quit)
     eprintf ("%s", strerror (errno));
 
-  for (psit = ps; psit < psend; psit++)
+  notify_send (&self->notify, "STOPPING=1");
+  sched_stop (&self->sched);
+  server_flush (self);
+
+  // The connections and the transitions go on in the next image.
+  if (self->restart)
+    server_handover (self, clients, psend, peers);
+
+  // The fixed slots are closed by their owners.
+  for (psit = clients; psit < psend; psit++)
     if (psit->fd >= 0)
       close (psit->fd);
 
@@ -622,12 +2518,20 @@ server_config (server_t* self, message_t const* msg)
       self->daemon = true;
       return true;
 
+    case FIELD_RATE_LIMIT:
+      admission_init (&self->admission, msg->v_int);
+      return true;
+
+    case FIELD_IDLE_EXIT:
+      self->idle_exit = MAX (msg->v_int, 0);
+      return true;
+
+    case FIELD_RESTORE:
+      self->oneshot = true;
+      return true;
+
     case FIELD_DEVNAME:
-      if (server_set_devname (self, msg->v_str))
-        return server_save (self, msg->field);
-      else
-        return false;
-      break;
+      return server_set_devname (self, msg->v_str);
 
     default:
       if (msg->type == TYPE_INT && msg->v_int >= 0)
@@ -643,9 +2547,16 @@ server_config (server_t* self, message_t const* msg)
             case FIELD_NUM_LEVELS:
               self->num_levels = msg->v_int;
               break;
+            case FIELD_LINKED:
+              self->linked = (msg->v_int > 0);
+              break;
+            case FIELD_FADE_BLANK:
+              self->fade_blank = (msg->v_int > 0);
+              break;
             default:
               break;
             }
+          server_map_levels (self);
           result = true;
         }
     }
@@ -660,55 +2571,162 @@ server_config (server_t* self, message_t const* msg)
 static bool_t
 server_command (server_t* self, message_t const* msg)
 {
-  switch (msg->field)
+  server_device_t* dev;
+
+  // The linked devices are driven as one.
+  char const* device = self->linked ? "" : msg->device;
+
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
     {
-    case FIELD_INC:
-      if (self->level < 0)
-        server_load (self, FIELD_SAVED);
-      else
-        self->level += (self->level + 1 <= self->num_levels);
-      break;
+      if (!device_is_selected (dev, device))
+        continue;
 
-    case FIELD_DEC:
-      if (self->level < 0)
-        server_load (self, FIELD_SAVED);
-      else
-        self->level -= (self->level - 1 >= 0);
-      break;
+      switch (msg->field)
+        {
+        case FIELD_INC:
+          if (dev->blanked || dev->level < 0)
+            server_power_on (self, dev);
+          else
+            dev->level += (dev->level + 1 <= dev->levels.num_levels);
+          break;
 
-    case FIELD_ON:
-      server_load (self, FIELD_SAVED);
-      break;
+        case FIELD_DEC:
+          if (dev->blanked || dev->level < 0)
+            server_power_on (self, dev);
+          else
+            dev->level -= (dev->level - 1 >= 0);
+          break;
 
-    case FIELD_OFF:
-      server_save (self, FIELD_SAVED);
-      self->level = -1;
-      break;
+        case FIELD_ON:
+          server_power_on (self, dev);
+          break;
 
-    case FIELD_SWITCH:
-      if (self->level < 0)
-        server_load (self, FIELD_SAVED);
-      else
+        case FIELD_OFF:
+          server_power_off (self, dev);
+          break;
+
+        case FIELD_SET:
+          server_power_on (self, dev);
+          dev->level = levels_percent (&dev->levels, msg->v_int);
+          break;
+
+        case FIELD_SWITCH:
+          if (dev->blanked || dev->level < 0)
+            server_power_on (self, dev);
+          else
+            server_power_off (self, dev);
+          break;
+
+        case FIELD_CALIBRATE:
+          server_calibrate (self, dev);
+          break;
+
+        default:
+          return false;
+        }
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+server_sleep (server_t* self, message_t const* msg)
+{
+  statpage_device_t devs[SCHED_MAX_DEVICES];
+  server_device_t* dev;
+  int i, n;
+
+  if (msg->field == FIELD_SLEEP)
+    {
+      // The devices are left where the transitions got, as the status
+      // page tells.
+      n = self->page ? statpage_read (self->page, devs, SCHED_MAX_DEVICES) : -1;
+
+      // Nothing is left to be written while the system sleeps.
+      for (dev = self->devs, i = 0; i < SCHED_MAX_DEVICES; dev++, i++)
         {
-          server_save (self, FIELD_SAVED);
-          self->level = -1;
+          dev->waking = false;
+
+          if (!dev->name)
+            continue;
+
+          sched_cancel (&self->sched, i);
+          server_save_level (self, dev);
+
+          if (dev->moving)
+            {
+              dev->moving = false;
+              server_notify (self, dev, WATCH_DONE, i < n ? devs[i].value : -1);
+            }
         }
-      break;
 
-    default:
-      return false;
+      self->waking = 0;
+      server_interrupt (self, "The transition was stopped by a system sleep");
+
+      return server_flush (self);
+    }
+
+  // The firmware may have changed the devices while the system slept, so
+  // all of them are set again, each one in a single write.
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    {
+      dev->target = -1;
+
+      if (dev->blanked && dev->power >= 0)
+        dev->power = BL_POWER_ON;
+    }
+
+  self->woke_at = latency_now ();
+  server_retarget_with (self, 0);
+
+  for (dev = self->devs, self->waking = 0; dev < self->devs + SCHED_MAX_DEVICES;
+       dev++)
+    {
+      dev->waking = (dev->name && dev->target >= 0);
+      self->waking += dev->waking;
     }
 
   return true;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+static void
+server_power_on (server_t* self, server_device_t* dev)
+{
+  // The brightness of a blanked device was left alone, so restoring the
+  // power brings back the exact previous value in a single write.
+  if (dev->blanked)
+    dev->blanked = false;
+  else
+    server_load_level (self, dev);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+server_power_off (server_t* self, server_device_t* dev)
+{
+  server_save_level (self, dev);
+
+  // Without bl_power the brightness itself fades to zero.
+  if (dev->power >= 0)
+    dev->blanked = true;
+  else
+    dev->level = -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
 static bool_t
-cb_server_stop (server_t* self __attribute__ ((unused)),
-                server_message_t const* smsg)
+cb_server_stop (server_t* self, server_message_t const* smsg)
 {
   message_t rep;
 
+  // The loop ends after this message, the client learns that the server
+  // is gone when the connection is closed.
+  self->restart = (smsg->msg.field == FIELD_RESTART);
+  self->requester = smsg->socket;
+  g_total_quit = true;
+
   rep.field = FIELD_NONE;
   rep.type = TYPE_INT;
   rep.v_int = getpid ();
@@ -719,186 +2737,195 @@ cb_server_stop (server_t* self __attribute__ ((unused)),
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
-cb_server_get_saved (server_t* self, server_message_t const* msg)
+cb_server_ring (server_t* self, server_message_t const* smsg)
 {
-  message_t res = MESSAGE_INIT;
+  message_t rep = MESSAGE_INIT;
+  int fds[2] = { self->ring_fd, self->ring_wake };
 
-  res.field = msg->msg.field;
-  res.type = TYPE_INT;
-  res.v_int = self->level;
+  rep.field = FIELD_RING;
 
-  return (reply (msg->socket, &res, sizeof (res)) == sizeof (res));
+  if (!self->ring)
+    {
+      _seterrf (rep.v_str, "%s", "The command ring is not available");
+      rep.type = TYPE_ERROR;
+      return (reply (smsg->socket, &rep, sizeof (rep)) == sizeof (rep));
+    }
+
+  return (fs_send_fds (smsg->socket, &rep, sizeof (rep), fds, 2)
+          == sizeof (rep));
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
-cb_server_device_list (server_t* self __attribute__ ((unused)),
-                       server_message_t const* msg)
+cb_server_watch (server_t* self, server_message_t const* smsg)
 {
-  DIR* dir;
-  char* path;
-  bool_t result = false;
-  message_t res;
-  int size = sizeof (res);
-
-  path = fs_path_join (BACKLIGHT, null);
-  dir = opendir (path);
-  ckfree (path);
-
-  if (dir != null)
-    {
-      struct dirent* ent;
-
-      res.field = msg->msg.field;
-      res.type = TYPE_STRING;
-      res.read_more = true;
-      result = true;
-
-      while ((ent = readdir (dir)) != null && result)
-        {
-          if (strcmp (ent->d_name, "..") == 0 || strcmp (ent->d_name, ".") == 0)
-            continue;
-
-          memset (res.v_str, 0, sizeof (res.v_str));
-          strcpy (res.v_str, ent->d_name);
-          result = (reply (msg->socket, &res, size) == size);
-        }
-
-      if (result)
-        {
-          res.type = TYPE_NONE;
-          res.read_more = false;
-          *res.v_str = 0;
-          result = (reply (msg->socket, &res, size) == size);
-        }
+  message_t rep = MESSAGE_INIT;
 
-      closedir (dir);
-    }
-  else
+  // The value of the request is the granularity of the VALUE events,
+  // none of them are sent when it is negative.
+  if (watch_add (&self->watch, smsg->socket, smsg->msg.v_int,
+                 smsg->socket == g_text_socket))
     {
-      res.type = TYPE_ERROR;
-      seterrf (res.v_str, "%s", strerror (errno));
-      reply (msg->socket, &res, size);
+      sched_set_values (&self->sched, self->watch.n_values > 0);
+      return true;
     }
 
-  return result;
+  rep.field = FIELD_WATCH;
+  rep.type = TYPE_ERROR;
+  _seterrf (rep.v_str, "%s", "Too many subscribers");
+
+  return (reply (smsg->socket, &rep, sizeof (rep)) == sizeof (rep));
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
-device_name_is_valid (char const* name)
+cb_server_get_saved (server_t* self, server_message_t const* msg)
 {
-  char* setter;
-  char* getter;
-  bool_t result;
+  message_t res = MESSAGE_INIT;
+  server_device_t* dev;
 
-  if (!name || !*name)
-    return false;
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES; dev++)
+    if (device_is_selected (dev, msg->msg.device))
+      break;
 
-  setter = fs_path_join (BACKLIGHT, name, "brightness", null);
-  getter = fs_path_join (BACKLIGHT, name, "actual_brightness", null);
-  result = (access (setter, W_OK) == 0 && access (getter, R_OK) == 0);
-  ckfree (setter);
-  ckfree (getter);
+  res.field = msg->msg.field;
+  res.type = TYPE_INT;
+  res.v_int = dev < self->devs + SCHED_MAX_DEVICES ? dev->level : -1;
 
-  return result;
+  return (reply (msg->socket, &res, sizeof (res)) == sizeof (res));
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-static int
-get_device_max (char const* devname)
+static bool_t
+cb_server_device_list (server_t* self, server_message_t const* msg)
 {
-  char* path;
-  int value = 0;
-  int fd;
+  inventory_t* inv = &self->inventory;
+  message_t* frames;
+  message_t* res;
+  char line[STRSIZE];
+  int i, len, used = 0;
+  int size;
+  bool_t result;
+
+  // The lines are packed into as few frames as possible and all of the
+  // frames go out in a single send().
+  if (!inventory_build (inv)
+      || !(frames = calloc (inv->n_items + 1, sizeof (*frames))))
+    {
+      message_t err = MESSAGE_INIT;
+
+      err.field = msg->msg.field;
+      err.type = TYPE_ERROR;
+      seterrf (err.v_str, "%s", strerror (errno));
+      eprintf ("%s", strerror (errno));
+      reply (msg->socket, &err, sizeof (err));
+
+      return false;
+    }
 
-  path = fs_path_join (BACKLIGHT, devname, "max_brightness", null);
+  res = frames;
+  res->field = msg->msg.field;
+  res->type = TYPE_NONE;
 
-  if ((fd = open (path, O_RDONLY)) >= 0)
+  for (i = 0; i < inv->n_items; i++)
     {
-      value = fs_getint (fd);
-      close (fd);
+      len = inventory_format (inv->items + i, line, sizeof (line));
+
+      if (used && used + len + 1 >= (int) sizeof (res->v_str))
+        {
+          res->read_more = true;
+          res[1].field = res->field;
+          res++;
+          used = 0;
+        }
+
+      used += snprintf (res->v_str + used, sizeof (res->v_str) - used, "%s%s",
+                        used ? "\n" : "", line);
+      res->type = TYPE_STRING;
     }
 
-  ckfree (path);
+  size = (res + 1 - frames) * sizeof (*frames);
+  result = (reply (msg->socket, frames, size) == size);
+  ckfree (frames);
 
-  return value;
+  return result;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
-static char*
-find_device (char* dest, int dest_size)
+static bool_t
+cb_server_stats (server_t* self, server_message_t const* msg)
 {
-  char* path;
-  DIR* dir;
-  int len;
+  latency_t const* stats[] = { &self->restore,      &self->resume,
+                               &self->first,        &self->handle,
+                               &self->ring_delay,   &self->receive,
+                               &self->watch.fanout, &self->sched.queue,
+                               &self->sched.first,  &self->sched.jitter,
+                               &self->sched.step,   &self->sched.write };
+  latency_t const** it;
+  server_device_t* dev;
+  config_map_t* map;
+  message_t res = MESSAGE_INIT;
+  int size = sizeof (res);
+  bool_t result = true;
+  int i;
 
-  dest[0] = 0;
-  path = fs_path_join (BACKLIGHT, null);
-  dir = opendir (path);
+  res.field = msg->msg.field;
+  res.type = TYPE_STRING;
+  res.read_more = true;
 
-  ckfree (path);
+  snprintf (res.v_str, sizeof (res.v_str), "device.io: %s",
+            devio_is_async (&self->sched.io) ? "io_uring" : "sync");
+  result = (reply (msg->socket, &res, size) == size);
 
-  if (dir != null)
+  for (dev = self->devs; dev < self->devs + SCHED_MAX_DEVICES && result; dev++)
     {
-      struct dirent* ent;
-      char bestdev[STRSIZE];
-      int value;
-      int max = 0;
-
-      *bestdev = 0;
-
-      while ((ent = readdir (dir)) != null)
-        {
-          if (ent->d_name[0] == '.' || strncmp (ent->d_name, "..", 2) == 0)
-            continue;
-
-          value = get_device_max (ent->d_name);
-
-          if (value > max)
-            {
-              strcpy (bestdev, ent->d_name);
-              max = value;
-            }
-        }
-
-      closedir (dir);
+      if (!dev->name)
+        continue;
+
+      map = server_conf_map (self, dev->name);
+      snprintf (res.v_str, sizeof (res.v_str),
+                "device: %s tick=%dms write=%dus read=%dus map=%d%s%s",
+                dev->name, dev->tick, dev->write_cost, dev->read_cost,
+                map->n_pairs, map->calibrated > 0 ? " calibrated" : "",
+                self->linked ? " linked" : "");
+      result = (reply (msg->socket, &res, size) == size);
+    }
 
-      if (*bestdev)
-        {
-          if (dest)
-            {
-              len = strlen (bestdev);
+  for (it = stats; it < stats + sizeof (stats) / sizeof (*stats) && result;
+       it++)
+    {
+      latency_format (*it, res.v_str, sizeof (res.v_str));
+      result = (reply (msg->socket, &res, size) == size);
+    }
 
-              if (len >= dest_size)
-                return null;
+  for (i = -1; result && i < self->admission.n_buckets; i++)
+    {
+      admission_format (&self->admission, i, res.v_str, sizeof (res.v_str));
+      result = (reply (msg->socket, &res, size) == size);
+    }
 
-              memcpy (dest, bestdev, len);
-              memset (dest + len, 0, dest_size - len);
-              return dest;
-            }
-          else
-            return strdup (bestdev);
-        }
+  if (result)
+    {
+      res.type = TYPE_NONE;
+      res.read_more = false;
+      *res.v_str = 0;
+      result = (reply (msg->socket, &res, size) == size);
     }
 
-  return null;
+  return result;
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 static bool_t
-server_device_set (server_t* self, int value)
+device_name_is_valid (server_t* self, char const* name)
 {
-  fs_setint (self->dev.set, value);
+  inventory_t* inv = &self->inventory;
 
-  return (server_device_get (self) == value);
-}
-//------------------------------------------------------------------------------
-//------------------------------------------------------------------------------
-static int
-server_device_get (server_t* self)
-{
-  return fs_getint (self->dev.get);
+  if (!name || !*name)
+    return false;
+
+  return (inventory_access (inv, name, "brightness", W_OK)
+          && inventory_access (inv, name, "actual_brightness", R_OK));
 }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
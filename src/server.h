@@ -9,6 +9,114 @@
 #ifndef SRC_SERVER_H_
 #define SRC_SERVER_H_
 
+#define CONFIG_MAX_DEVICES 64
+#define CONFIG_MAX_PAIRS 32
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The saved level and the probed I/O costs of one device.
+typedef struct config_device_t
+{
+  char name[DEVSIZE];
+  int level;
+  int write_cost;
+  int read_cost;
+} config_device_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct config_pair_t
+{
+  int written;
+  int actual;
+} config_pair_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The values a device rounds the written ones to, kept for the device
+// entry of the same index. With 'calibrated' the pairs come from a
+// calibration pass and hold every value the device can reach, otherwise
+// they are the rounded targets seen so far.
+typedef struct config_map_t
+{
+  int calibrated;
+  int n_pairs;
+  config_pair_t pairs[CONFIG_MAX_PAIRS];
+} config_map_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'devname' is the comma separated list of the devices chosen by the user.
+// 'probed' and the costs after it belong to the single device of the
+// older versions, they are only kept for the layout of the file.
+// 'values' are the brightness of the saved levels of the devices, written
+// at once by the restore at boot.
+typedef struct config_t
+{
+  int minimal;
+  int num_levels;
+  int transition;
+  int saved_level;
+  char devname[STRSIZE];
+  char probed[STRSIZE];
+  int write_cost;
+  int read_cost;
+  int linked;
+  config_device_t devices[CONFIG_MAX_DEVICES];
+  int fade_blank;
+  config_map_t maps[CONFIG_MAX_DEVICES];
+  int values[CONFIG_MAX_DEVICES];
+} config_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The size of the state file written before the device probing was added.
+#define CONFIG_V1_SIZE (offsetof (config_t, devname) + STRSIZE)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A device driven by the server. Its index in the table is its index in
+// the scheduler, 'name' is null for a free entry. 'power' is the last
+// known value of bl_power, -1 when the device has none. 'rounded' tells
+// that the device has a map of the rounded values, 'calibrating' counts
+// the rounded samples of the running calibration and is -1 without one.
+// 'moving' is set from the new target until the device reports it,
+// 'waking' from the resume until the device reports the restored value.
+typedef struct server_device_t
+{
+  char* name;
+  int max;
+  int tick;
+  int write_cost;
+  int read_cost;
+  levels_t levels;
+  int level;
+  int target;
+  int power;
+  bool_t blanked;
+  bool_t rounded;
+  int calibrating;
+  bool_t overflow;
+  bool_t moving;
+  bool_t waking;
+} server_device_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The number of the commands that wait for their transitions at once.
+#define SERVER_MAX_WAITERS 64
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The unfinished line of a client of the text protocol.
+typedef struct server_line_t
+{
+  int len;
+  char buf[BUFFER_SIZE];
+} server_line_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A command sent with --wait, 'msg' is its answer.
+typedef struct server_waiter_t
+{
+  int fd;
+  message_t msg;
+} server_waiter_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+
 void server_init (context_t* ctx);
 
 #endif /* SRC_SERVER_H_ */
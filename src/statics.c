@@ -17,7 +17,9 @@ __options (void)
       "for config and saves.",
       DEFAULT_WORKDIR },
 
-    { FIELD_SOCKNAME, 's', "socket", "Use the specified socket file.",
+    { FIELD_SOCKNAME, 's', "socket",
+      "Use the specified socket file, a name starting with '@' is "
+      "an abstract socket.",
       DEFAULT_SOCKET },
 
     { FIELD_PIDFILE, 'p', "pidfile", "Use the specified PID file.",
@@ -29,12 +31,26 @@ __options (void)
     { FIELD_DAEMON, 'd', "daemon", "Start the server in background",
       DEFAULT_NONE },
 
+    { FIELD_RATE_LIMIT, 0, "rate-limit",
+      "The number of commands per second accepted from one user. "
+      "Twice as many are allowed in a burst, 0 disables the limit.",
+      DEFAULT_RATE_LIMIT },
+
+    { FIELD_IDLE_EXIT, 0, "idle-exit",
+      "With socket activation, the number of idle seconds after which "
+      "the server exits, 0 keeps it running.",
+      DEFAULT_NONE },
+
     { FIELD_INC, 0, "increase", "Increase brightness", DEFAULT_NONE },
     { FIELD_INC, 0, "up", "Alias for 'increase'", DEFAULT_NONE },
     { FIELD_DEC, 0, "decrease", "Decrease brightness", DEFAULT_NONE },
     { FIELD_DEC, 0, "dn", "Alias for 'decrease'", DEFAULT_NONE },
     { FIELD_ON, 0, "on", "Turn on the disabled display", DEFAULT_NONE },
     { FIELD_OFF, 0, "off", "Turn off the enabled display", DEFAULT_NONE },
+    { FIELD_SET, 0, "set",
+      "Set the brightness level to the given percent of the levels, "
+      "like 'set 40'.",
+      DEFAULT_NONE },
 
     { FIELD_SWITCH, 0, "switch", "Change the state of the dispalay",
       DEFAULT_NONE },
@@ -42,6 +58,10 @@ __options (void)
     { FIELD_STOP, 0, "stop", "Stop the server", DEFAULT_NONE },
     { FIELD_START, 0, "start", "Start the server", DEFAULT_NONE },
     { FIELD_RESTART, 0, "restart", "Restart server", DEFAULT_NONE },
+    { FIELD_RESTORE, 0, "restore",
+      "Write the saved brightness to the devices and exit, "
+      "for the early boot.",
+      DEFAULT_NONE },
 
     { FIELD_MINIMAL, 0, "minimal",
       "Minimum brightness, below which"
@@ -58,34 +78,94 @@ __options (void)
       "in the brightness level will be applied",
       DEFAULT_TRANSITION },
 
-    { FIELD_DEVNAME, 0, "devname", "Choose force backlight devices.",
+    { FIELD_LINKED, 0, "linked",
+      "With 1 all of the devices are changed together and fade "
+      "in lockstep, with 0 each of them is changed on its own.",
+      DEFAULT_NONE },
+
+    { FIELD_FADE_BLANK, 0, "fade-blank",
+      "With 1 the display fades out before its power is cut and fades "
+      "in after it is restored, with 0 it is switched at once.",
+      DEFAULT_NONE },
+
+    { FIELD_DEVNAME, 0, "devname",
+      "Choose force backlight devices, "
+      "several of them are separated by commas. The LEDs are named "
+      "'leds/NAME', a pattern like 'leds/*::kbd_backlight' takes all "
+      "of the matching devices.",
       DEFAULT_NONE },
 
+    { FIELD_DEVICE, 'D', "device",
+      "Apply the command to the specified device only.", DEFAULT_NONE },
+
     { FIELD_SAVED, 0, "saved", "Request the last saved value.", DEFAULT_NONE },
 
     { FIELD_LIST, 0, "list", "Request the list of backlight devices.",
       DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "hibernate", "This is a stub for compatibility.",
+    { FIELD_STATS, 0, "stats", "Request the latency statistics of the server.",
       DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "suspend", "This is a stub for compatibility.",
+    { FIELD_CALIBRATE, 0, "calibrate",
+      "Learn the values the device rounds the written ones to. "
+      "The display flickers for a moment.",
       DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "pre", "This is a stub for compatibility.", DEFAULT_NONE },
+    { FIELD_STATUS, 0, "status",
+      "Print the brightness of the devices from the status page of the "
+      "server, without connecting to it.",
+      DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "suspend_hybrid", "This is a stub for compatibility.",
+    { FIELD_REPEAT, 0, "repeat",
+      "Read the status page or send the command the given number of "
+      "times and print the rate.",
       DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "thaw", "This is a stub for compatibility.",
+    { FIELD_RING, 0, "ring",
+      "Send the brightness command through the shared memory ring "
+      "of the server. Only for root and the owner of the server.",
       DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "resume", "This is a stub for compatibility.",
+    { FIELD_WATCH, 0, "watch",
+      "Print the changes of the brightness and of the devices as they "
+      "happen, until interrupted.",
       DEFAULT_NONE },
 
-    { FIELD_STUB, 0, "post", "This is a stub for compatibility.",
+    { FIELD_GRANULARITY, 0, "granularity",
+      "With 'watch', print the brightness whenever it moves by the given "
+      "percent of the maximum, 0 prints every step of a transition.",
       DEFAULT_NONE },
 
+    { FIELD_WAIT, 0, "wait",
+      "Wait for the transitions started by the command to end before "
+      "the server answers.",
+      DEFAULT_NONE },
+
+    { FIELD_NO_WAIT, 0, "no-wait",
+      "Send the brightness command as a single datagram and return "
+      "without an answer from the server.",
+      DEFAULT_NONE },
+
+    { FIELD_SLEEP, 0, "pre",
+      "Save the state and stop the transitions before the system sleeps. "
+      "The kind of the sleep may follow, like in 'pre suspend'.",
+      DEFAULT_NONE },
+
+    { FIELD_SLEEP, 0, "suspend", "Alias for 'pre'", DEFAULT_NONE },
+    { FIELD_SLEEP, 0, "hibernate", "Alias for 'pre'", DEFAULT_NONE },
+    { FIELD_SLEEP, 0, "suspend_hybrid", "Alias for 'pre'", DEFAULT_NONE },
+    { FIELD_SLEEP, 0, "hybrid-sleep", "Alias for 'pre'", DEFAULT_NONE },
+    { FIELD_SLEEP, 0, "suspend-then-hibernate", "Alias for 'pre'",
+      DEFAULT_NONE },
+
+    { FIELD_WAKE, 0, "post",
+      "Restore the brightness in one write after the system wakes up. "
+      "The kind of the sleep may follow, like in 'post suspend'.",
+      DEFAULT_NONE },
+
+    { FIELD_WAKE, 0, "resume", "Alias for 'post'", DEFAULT_NONE },
+    { FIELD_WAKE, 0, "thaw", "Alias for 'post'", DEFAULT_NONE },
+
     { FIELD_NONE, 0, null, null, DEFAULT_NONE }
   };
 
@@ -110,9 +190,11 @@ __defaults (void)
                                     { .v_str = APPNAME ".socket" },
                                     { .v_str = APPNAME ".pid" },
                                     { .v_str = APPNAME ".conf" },
+                                    { .v_str = APPNAME ".status" },
                                     { .v_int = 2000 },
                                     { .v_int = 20 },
                                     { .v_int = 100 },
+                                    { .v_int = 20 },
                                     { .v_str = null } };
   return defs;
 }
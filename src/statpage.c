@@ -0,0 +1,179 @@
+/*
+ * statpage.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A writer holds the page for a few hundred nanoseconds, a reader that
+// keeps missing it is reading a page left by a crashed server. A writer
+// preempted in the middle holds it for a whole time slice, the reader
+// yields to it then.
+#define STATPAGE_RETRIES 100000
+// The turns a writer spins on the page held by the other thread before
+// it gives the CPU away, the holder may have been preempted.
+#define STATPAGE_SPINS 64
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void*
+statpage_map (char const* path, int flags, int prot)
+{
+  void* page;
+  int fd, rc;
+
+  if ((fd = open (path, flags | O_CLOEXEC, 00644)) < 0)
+    return null;
+
+  if ((flags & O_CREAT) && ftruncate (fd, sizeof (statpage_t)) < 0)
+    page = MAP_FAILED;
+  else
+    page = mmap (null, sizeof (statpage_t), prot, MAP_SHARED, fd, 0);
+
+  rc = errno;
+  set_fd (fd, -1);
+  errno = rc;
+
+  return (page == MAP_FAILED) ? null : page;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+statpage_t*
+statpage_create (char const* path)
+{
+  statpage_t* page;
+  unsigned seq;
+
+  if (!(page = statpage_map (path, O_RDWR | O_CREAT, PROT_READ | PROT_WRITE)))
+    return null;
+
+  // The readers may hold the page of the previous server. A write it has
+  // not finished is finished here, so they do not wait forever.
+  seq = atomic_load_explicit (&page->seq, memory_order_relaxed);
+  atomic_store_explicit (&page->seq, seq | 1, memory_order_relaxed);
+  atomic_flag_clear_explicit (&page->lock, memory_order_relaxed);
+  atomic_thread_fence (memory_order_release);
+
+  page->magic = STATPAGE_MAGIC;
+  page->size = sizeof (*page);
+  page->pid = getpid ();
+  page->n_devs = 0;
+  memset (page->devs, 0, sizeof (page->devs));
+
+  atomic_store_explicit (&page->seq, (seq | 1) + 1, memory_order_release);
+
+  return page;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+statpage_destroy (statpage_t* page)
+{
+  if (!page)
+    return;
+
+  statpage_begin (page);
+  page->pid = 0;
+  statpage_end (page);
+
+  munmap (page, sizeof (*page));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+statpage_begin (statpage_t* page)
+{
+  unsigned seq;
+  int spins = 0;
+
+  while (atomic_flag_test_and_set_explicit (&page->lock, memory_order_acquire))
+    if (++spins > STATPAGE_SPINS)
+      sched_yield ();
+
+  seq = atomic_load_explicit (&page->seq, memory_order_relaxed);
+  atomic_store_explicit (&page->seq, seq + 1, memory_order_relaxed);
+  atomic_thread_fence (memory_order_release);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+statpage_end (statpage_t* page)
+{
+  unsigned seq = atomic_load_explicit (&page->seq, memory_order_relaxed);
+
+  atomic_store_explicit (&page->seq, seq + 1, memory_order_release);
+  atomic_flag_clear_explicit (&page->lock, memory_order_release);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+statpage_t const*
+statpage_open (char const* path)
+{
+  statpage_t const* page = statpage_map (path, O_RDONLY, PROT_READ);
+
+  if (page && (page->magic != STATPAGE_MAGIC || page->size != sizeof (*page)))
+    {
+      statpage_close (page);
+      errno = EPROTO;
+      return null;
+    }
+
+  return page;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+statpage_close (statpage_t const* page)
+{
+  if (page)
+    munmap ((void*) page, sizeof (*page));
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+statpage_read (statpage_t const* page, statpage_device_t* devs, int max)
+{
+  unsigned seq;
+  int i, n, pid;
+
+  for (i = 0; i < STATPAGE_RETRIES; i++)
+    {
+      seq = atomic_load_explicit (&page->seq, memory_order_acquire);
+
+      if (seq & 1)
+        {
+          sched_yield ();
+          continue;
+        }
+
+      pid = page->pid;
+      n = MAX (MIN (page->n_devs, max), 0);
+      memcpy (devs, page->devs, n * sizeof (*devs));
+      atomic_thread_fence (memory_order_acquire);
+
+      if (atomic_load_explicit (&page->seq, memory_order_relaxed) != seq)
+        continue;
+      else if (pid == 0)
+        break;
+
+      return n;
+    }
+
+  errno = (i < STATPAGE_RETRIES) ? ESRCH : EAGAIN;
+
+  return -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,64 @@
+/*
+ * statpage.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_STATPAGE_H_
+#define SRC_STATPAGE_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include <stdatomic.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define STATPAGE_MAGIC 0x424c5350
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'value' is the brightness last read back from the device, -1 before the
+// first read. 'level' is -1 when the device is off. 'progress' is the part
+// of the running transition that is done in per mille, 1000 at rest.
+typedef struct statpage_device_t
+{
+  char name[DEVSIZE];
+  int value;
+  int target;
+  int max;
+  int level;
+  int num_levels;
+  int progress;
+  int blanked;
+} statpage_device_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The state of the devices published by the server in a file mapped by
+// the readers. The writers are the two threads of the server, they take
+// 'lock' and make 'seq' odd while they write; a reader copies the page
+// and starts over when 'seq' was odd or has changed meanwhile, so it gets
+// a consistent copy without a system call. 'pid' is 0 when the server
+// has exited.
+typedef struct statpage_t
+{
+  int magic;
+  int size;
+  int pid;
+  atomic_uint seq;
+  atomic_flag lock;
+  int n_devs;
+  statpage_device_t devs[SCHED_MAX_DEVICES];
+} statpage_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+statpage_t* statpage_create (char const* path);
+void statpage_destroy (statpage_t* page);
+void statpage_begin (statpage_t* page);
+void statpage_end (statpage_t* page);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+statpage_t const* statpage_open (char const* path);
+void statpage_close (statpage_t const* page);
+int statpage_read (statpage_t const* page, statpage_device_t* devs, int max);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_STATPAGE_H_ */
@@ -20,23 +20,32 @@ union default_value_t
 };
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
+// The field comes first: a binary message starts with a small number,
+// which tells it from a line of the text protocol.
 struct message_t
 {
+  field_t field;
+
   union
   {
     int v_int;
     char v_str[STRSIZE];
   };
 
-  field_t field;
   bool_t read_more;
   type_t type;
+
+  // Selects the device the command is applied to, all of them if empty.
+  char device[DEVSIZE];
+
+  // Holds the answer to the command until its transitions are over.
+  bool_t wait;
 };
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
 #define MESSAGE_INIT                                                           \
   {                                                                            \
-    { 0 }, FIELD_NONE, false, TYPE_NONE                                        \
+    FIELD_NONE, { 0 }, false, TYPE_NONE, { 0 }, false                          \
   }
 //------------------------------------------------------------------------------
 //------------------------------------------------------------------------------
@@ -0,0 +1,99 @@
+/*
+ * transition.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <stdlib.h>
+#include <string.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+transition_init (transition_t* tr, int capacity)
+{
+  memset (tr, 0, sizeof (*tr));
+
+  tr->capacity = capacity;
+  tr->current = calloc (capacity, sizeof (*tr->current));
+  tr->target = calloc (capacity, sizeof (*tr->target));
+  tr->from = calloc (capacity, sizeof (*tr->from));
+  tr->value = calloc (capacity, sizeof (*tr->value));
+  tr->span = calloc (capacity, sizeof (*tr->span));
+  tr->rate = calloc (capacity, sizeof (*tr->rate));
+  tr->start = calloc (capacity, sizeof (*tr->start));
+
+  if (tr->current && tr->target && tr->from && tr->value && tr->span
+      && tr->rate && tr->start)
+    {
+      memset (tr->current, -1, capacity * sizeof (*tr->current));
+      memset (tr->from, -1, capacity * sizeof (*tr->from));
+      return true;
+    }
+
+  transition_clear (tr);
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+transition_clear (transition_t* tr)
+{
+  if (!tr)
+    return;
+
+  ckfree (tr->current);
+  ckfree (tr->target);
+  ckfree (tr->from);
+  ckfree (tr->value);
+  ckfree (tr->span);
+  ckfree (tr->rate);
+  ckfree (tr->start);
+  tr->capacity = 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+transition_begin (transition_t* tr, int index, unsigned now, int duration,
+                  int tick)
+{
+  tr->from[index] = tr->current[index];
+  tr->span[index] = tr->target[index] - tr->from[index];
+  tr->rate[index] = 1.0f / MAX (duration, 1);
+
+  // A transition shorter than a tick is finished by the first step, the
+  // one of no length too: it starts a whole 'rate' before now.
+  tr->start[index] = (duration <= tick) ? now - MAX (duration, 1) : now;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+transition_step (transition_t* tr, int count, unsigned now)
+{
+  int const* restrict from = tr->from;
+  float const* restrict span = tr->span;
+  float const* restrict rate = tr->rate;
+  unsigned const* restrict start = tr->start;
+  int* restrict value = tr->value;
+  float progress;
+  int i;
+
+  // The value is interpolated by the elapsed time rather than advanced
+  // by a fixed step, so the transition takes the configured time at any
+  // tick interval and survives skipped ticks. The idle devices are
+  // computed too, it is cheaper than branching on them.
+  for (i = 0; i < count; i++)
+    {
+      progress = (int) (now - start[i]) * rate[i];
+      progress = progress < 1.0f ? progress : 1.0f;
+      progress = progress > 0.0f ? progress : 0.0f;
+      value[i] = from[i] + (int) (span[i] * progress);
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,37 @@
+/*
+ * transition.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_TRANSITION_H_
+#define SRC_TRANSITION_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The transitions of all of the devices, one array per field. A step
+// computes the next value of every device in one branchless loop that
+// the compiler turns into vector instructions. The times are in
+// milliseconds and wrap around, only their differences are used.
+typedef struct transition_t
+{
+  int capacity;
+  int* current;
+  int* target;
+  int* from;
+  int* value;
+  float* span;
+  float* rate;
+  unsigned* start;
+} transition_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t transition_init (transition_t* tr, int capacity);
+void transition_clear (transition_t* tr);
+void transition_begin (transition_t* tr, int index, unsigned now,
+                       int duration, int tick);
+void transition_step (transition_t* tr, int count, unsigned now);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_TRANSITION_H_ */
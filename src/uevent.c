@@ -0,0 +1,183 @@
+/*
+ * uevent.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/netlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define UEVENT_BUFFER_SIZE 4096
+#define UEVENT_KERNEL_GROUP 1
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#ifdef WITH_UEVENT_FD
+static int
+uevent_inherited (char const* env)
+{
+  struct stat st;
+  char* end;
+  long fd;
+  int type;
+  socklen_t len = sizeof (type);
+
+  fd = strtol (env, &end, 10);
+
+  // Anything but an open datagram socket would be read as events.
+  if (*end || fd < 0 || fd > INT_MAX || fstat (fd, &st) < 0
+      || !S_ISSOCK (st.st_mode)
+      || getsockopt (fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0
+      || type != SOCK_DGRAM)
+    {
+      eprintf ("%s is not a datagram socket: %s", UEVENT_FD_ENV, env);
+      errno = ENOTSOCK;
+      return -1;
+    }
+
+  return fd;
+}
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+uevent_open (void)
+{
+  struct sockaddr_nl addr;
+  int fd;
+
+#ifdef WITH_UEVENT_FD
+  char const* env;
+
+  if ((env = getenv (UEVENT_FD_ENV)) && *env)
+    return uevent_inherited (env);
+#endif
+
+  fd = socket (AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+               NETLINK_KOBJECT_UEVENT);
+
+  if (fd < 0)
+    return -1;
+
+  memset (&addr, 0, sizeof (addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = UEVENT_KERNEL_GROUP;
+
+  if (bind (fd, (struct sockaddr*) &addr, sizeof (addr)) < 0)
+    set_fd (fd, -1);
+
+  return fd;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+uevent_open_pair (int* feeder)
+{
+  int fds[2];
+
+  if (socketpair (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds) < 0)
+    return -1;
+
+  *feeder = fds[1];
+
+  return fds[0];
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+uevent_receive (int fd, uevent_t* ev)
+{
+  char buf[UEVENT_BUFFER_SIZE];
+  struct sockaddr_nl addr;
+  struct iovec iov = { buf, sizeof (buf) - 1 };
+  struct msghdr hdr;
+  int len;
+
+  memset (&hdr, 0, sizeof (hdr));
+  memset (&addr, 0, sizeof (addr));
+  hdr.msg_name = &addr;
+  hdr.msg_namelen = sizeof (addr);
+  hdr.msg_iov = &iov;
+  hdr.msg_iovlen = 1;
+
+  if ((len = recvmsg (fd, &hdr, MSG_DONTWAIT)) == 0)
+    return false;
+  else if (len < 0)
+    {
+      // The kernel dropped some events, the caller has to resync.
+      if (errno != ENOBUFS)
+        return false;
+
+      memset (ev, 0, sizeof (*ev));
+      ev->action = UEVENT_OVERFLOW;
+
+      return true;
+    }
+
+  // Only the kernel may speak on the netlink socket, a stand-in
+  // socket has no netlink address at all.
+  if (addr.nl_family == AF_NETLINK && addr.nl_pid != 0)
+    {
+      memset (ev, 0, sizeof (*ev));
+      return true;
+    }
+
+  buf[len] = 0;
+
+  return uevent_parse (buf, len, ev);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+uevent_parse (char const* buf, int len, uevent_t* ev)
+{
+  char const* end = buf + len;
+  char const* p;
+  char const* value;
+  char const* slash;
+
+  memset (ev, 0, sizeof (*ev));
+
+  // The message is the "action@devpath" header followed by KEY=VALUE
+  // pairs, all of them null-terminated.
+  for (p = buf; p < end; p += strnlen (p, end - p) + 1)
+    {
+      if ((value = strchr (p, '=')) == null)
+        continue;
+
+      value++;
+
+      if (strncmp (p, "ACTION=", 7) == 0)
+        {
+          if (strcmp (value, "add") == 0)
+            ev->action = UEVENT_ADD;
+          else if (strcmp (value, "remove") == 0)
+            ev->action = UEVENT_REMOVE;
+          else if (strcmp (value, "change") == 0)
+            ev->action = UEVENT_CHANGE;
+        }
+      else if (strncmp (p, "SUBSYSTEM=", 10) == 0)
+        snprintf (ev->subsystem, sizeof (ev->subsystem), "%s", value);
+      else if (strncmp (p, "DEVPATH=", 8) == 0)
+        {
+          slash = strrchr (value, '/');
+          snprintf (ev->name, sizeof (ev->name), "%s",
+                    slash ? slash + 1 : value);
+        }
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,45 @@
+/*
+ * uevent.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_UEVENT_H_
+#define SRC_UEVENT_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The descriptor of a datagram socket fed with the uevents by someone
+// else, used instead of the netlink socket when it is set. Only honored
+// by a build with WITH_UEVENT_FD, for the tests.
+#ifdef WITH_UEVENT_FD
+#define UEVENT_FD_ENV "BACKLIGHT_UEVENT_FD"
+#endif
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef enum uevent_action_t
+{
+  UEVENT_OTHER,
+  UEVENT_ADD,
+  UEVENT_REMOVE,
+  UEVENT_CHANGE,
+  UEVENT_OVERFLOW
+} uevent_action_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct uevent_t
+{
+  uevent_action_t action;
+  char subsystem[32];
+  char name[STRSIZE];
+} uevent_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int uevent_open (void);
+int uevent_open_pair (int* feeder);
+bool_t uevent_receive (int fd, uevent_t* ev);
+bool_t uevent_parse (char const* buf, int len, uevent_t* ev);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_UEVENT_H_ */
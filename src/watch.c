@@ -0,0 +1,234 @@
+/*
+ * watch.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#include "includes.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+watch_init (watch_t* self)
+{
+  memset (self, 0, sizeof (*self));
+  latency_init (&self->fanout, "ipc.watch");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+watch_clear (watch_t* self)
+{
+  watcher_t* it;
+
+  // The connections themselves are closed with the rest of the clients.
+  for (it = self->subs; it < self->subs + self->n_subs; it++)
+    ckfree (it->last);
+
+  self->n_subs = 0;
+  self->n_values = 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+watch_add (watch_t* self, int fd, int granularity, bool_t text)
+{
+  watcher_t* sub;
+  int i;
+
+  if (watch_has (self, fd) || self->n_subs >= WATCH_MAX_SUBSCRIBERS)
+    return false;
+
+  sub = self->subs + self->n_subs;
+  sub->fd = fd;
+  sub->granularity = granularity;
+  sub->last = null;
+  sub->text = text;
+
+  if (granularity >= 0)
+    {
+      if (!(sub->last = malloc (SCHED_MAX_DEVICES * sizeof (int))))
+        return false;
+
+      for (i = 0; i < SCHED_MAX_DEVICES; i++)
+        sub->last[i] = -1;
+
+      self->n_values++;
+    }
+
+  self->n_subs++;
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+watch_remove (watch_t* self, int fd)
+{
+  watcher_t* it;
+
+  for (it = self->subs; it < self->subs + self->n_subs; it++)
+    {
+      if (it->fd != fd)
+        continue;
+
+      self->n_values -= (it->last != null);
+      ckfree (it->last);
+      *it = self->subs[--self->n_subs];
+      return;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+bool_t
+watch_has (watch_t const* self, int fd)
+{
+  watcher_t const* it;
+
+  for (it = self->subs; it < self->subs + self->n_subs; it++)
+    if (it->fd == fd)
+      return true;
+
+  return false;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+watch_filter (watcher_t* sub, int device, watch_event_t const* ev)
+{
+  int step;
+
+  switch (ev->type)
+    {
+    case WATCH_VALUE:
+      if (!sub->last)
+        return false;
+
+      // The granularity is counted from the value sent last, so a slow
+      // fade is reported as well as a fast one.
+      step = MAX ((long long) ev->max * sub->granularity / 100, 1LL);
+
+      if (sub->last[device] >= 0 && abs (ev->value - sub->last[device]) < step)
+        return false;
+      /* fall through */
+
+    case WATCH_DONE:
+      if (sub->last)
+        sub->last[device] = ev->value;
+      break;
+
+    case WATCH_ADDED:
+    case WATCH_REMOVED:
+      if (sub->last)
+        sub->last[device] = -1;
+      break;
+
+    case WATCH_TARGET:
+      break;
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+watch_deliver (watcher_t* sub, int device, watch_event_t const* ev)
+{
+  char line[WATCH_LINE_SIZE];
+  int len;
+
+  if (!watch_filter (sub, device, ev))
+    return true;
+
+  if (!sub->text)
+    return (send (sub->fd, ev, sizeof (*ev), MSG_DONTWAIT | MSG_NOSIGNAL)
+            == sizeof (*ev));
+
+  len = watch_format (ev, line, sizeof (line));
+
+  return (send (sub->fd, line, len, MSG_DONTWAIT | MSG_NOSIGNAL) == len);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+watch_send (watch_t* self, int device, watch_event_t const* ev)
+{
+  watcher_t* it;
+  long long start;
+
+  if (self->n_subs == 0)
+    return;
+
+  start = latency_now ();
+
+  for (it = self->subs; it < self->subs + self->n_subs;)
+    {
+      if (watch_deliver (it, device, ev))
+        {
+          it++;
+          continue;
+        }
+
+      // A subscriber that does not read its events is not waited for,
+      // the hangup of its connection lets the poll loop close it.
+      shutdown (it->fd, SHUT_RDWR);
+      watch_remove (self, it->fd);
+    }
+
+  latency_add (&self->fanout, start);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void
+watch_send_to (watch_t* self, int fd, int device, watch_event_t const* ev)
+{
+  watcher_t* it;
+
+  for (it = self->subs; it < self->subs + self->n_subs; it++)
+    {
+      if (it->fd != fd || watch_deliver (it, device, ev))
+        continue;
+
+      shutdown (it->fd, SHUT_RDWR);
+      watch_remove (self, it->fd);
+      return;
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+watch_format (watch_event_t const* ev, char* dest, int size)
+{
+  static char const* names[] = { "target", "value", "done", "added",
+                                 "removed" };
+  char level[sizeof ("level -2147483648")] = "off";
+  int len;
+
+  if ((unsigned) ev->type >= sizeof (names) / sizeof (*names) || size < 2)
+    return snprintf (dest, size, "%s", "");
+
+  if (ev->level >= 0)
+    snprintf (level, sizeof (level), "level %d", ev->level);
+
+  len = snprintf (dest, size, "%s %.*s %d/%d -> %d %s\n", names[ev->type],
+                  (int) sizeof (ev->device), ev->device, ev->value, ev->max,
+                  ev->target, level);
+
+  // A line cut to the buffer still ends with its newline, the readers of
+  // the text protocol split the events on it.
+  if (len >= size)
+    {
+      len = size - 1;
+      dest[len - 1] = '\n';
+    }
+
+  return len;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,80 @@
+/*
+ * watch.h
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+
+#ifndef SRC_WATCH_H_
+#define SRC_WATCH_H_
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define WATCH_MAX_SUBSCRIBERS 256
+//------------------------------------------------------------------------------
+// The longest line of watch_format(): the name of the event, the device
+// and four numbers with their words.
+#define WATCH_LINE_SIZE (DEVSIZE + 80)
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// TARGET is sent when a device is given a new target, VALUE when its
+// brightness moves, DONE when it reaches the target or stops short of it.
+// ADDED and REMOVED follow the devices taken and released by the server.
+typedef enum watch_type_t
+{
+  WATCH_TARGET,
+  WATCH_VALUE,
+  WATCH_DONE,
+  WATCH_ADDED,
+  WATCH_REMOVED
+} watch_type_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The event as it is sent to the subscribers, 'level' is -1 when the device
+// is off.
+typedef struct watch_event_t
+{
+  watch_type_t type;
+  int value;
+  int target;
+  int max;
+  int level;
+  char device[DEVSIZE];
+} watch_event_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// 'granularity' is the move of the brightness in percent of the maximum
+// that is worth a VALUE event, the subscriber gets none of them when it
+// is negative. 'last' holds the values last sent for each device. A
+// subscriber of the text protocol gets the events as lines.
+typedef struct watcher_t
+{
+  int fd;
+  int granularity;
+  int* last;
+  bool_t text;
+} watcher_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// The subscribers of the IPC thread. An event is sent to all of them
+// without waiting, the one whose connection is full is dropped.
+typedef struct watch_t
+{
+  int n_subs;
+  int n_values;
+  watcher_t subs[WATCH_MAX_SUBSCRIBERS];
+  latency_t fanout;
+} watch_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+void watch_init (watch_t* self);
+void watch_clear (watch_t* self);
+bool_t watch_add (watch_t* self, int fd, int granularity, bool_t text);
+void watch_remove (watch_t* self, int fd);
+bool_t watch_has (watch_t const* self, int fd);
+void watch_send (watch_t* self, int device, watch_event_t const* ev);
+void watch_send_to (watch_t* self, int fd, int device, watch_event_t const* ev);
+int watch_format (watch_event_t const* ev, char* dest, int size);
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#endif /* SRC_WATCH_H_ */
@@ -0,0 +1,724 @@
+/*
+ * bench.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Times the hot paths of the daemon in-process, with no device and no
+// running server, so the numbers can be compared between builds and
+// machines. Each section runs its loop BENCH_ROUNDS times and prints the
+// best round.
+//
+//   backlight-bench [SECTION]...
+//
+// Without a section all of them are run. The sections that check a
+// behaviour too make the program fail when it does not hold.
+#define _GNU_SOURCE
+#include "includes.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define BENCH_ROUNDS 5
+#define BENCH_STEPS 200000
+#define BENCH_DURATION 400
+#define BENCH_READS 2000000
+#define BENCH_COMMANDS 1000000
+#define BENCH_PRODUCERS 4
+#define BENCH_BATCH 32
+#define BENCH_DEVICES 64
+#define BENCH_FDS 4096
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct bench_t
+{
+  char const* name;
+  void (*run) (void);
+} bench_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A device of the transition loop the engine had before transition.c,
+// one structure per device and a division per step.
+typedef struct bench_device_t
+{
+  int from;
+  int target;
+  int current;
+  int value;
+  long long start;
+  int transition;
+} bench_device_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// A thread that writes the status page and the most CPU time it spent
+// waiting for it.
+typedef struct bench_writer_t
+{
+  statpage_t* page;
+  long long worst;
+} bench_writer_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static volatile int bench_sink;
+static atomic_bool bench_running;
+static cmdring_t* bench_ring;
+static int bench_values[BENCH_FDS];
+static int bench_failures;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static long long
+bench_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_report (char const* what, long long took, long long ops)
+{
+  printf ("%-32s %10.1f ns/op\n", what, (double) took / ops);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_expect (bool_t ok, char const* what)
+{
+  printf ("%-32s %10s\n", what, ok ? "ok" : "FAILED");
+  bench_failures += !ok;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+bench_device_read (void* data __attribute__ ((unused)), int fd, char* buf,
+                   int size)
+{
+  return (fd < BENCH_FDS) ? snprintf (buf, size, "%d", bench_values[fd]) : -1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+bench_device_write (void* data __attribute__ ((unused)), int fd,
+                    char const* buf, int len)
+{
+  // About what a write to the sysfs of a backlight costs.
+  usleep (100);
+
+  if (fd >= BENCH_FDS)
+    return -1;
+
+  bench_values[fd] = atoi (buf);
+
+  return len;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_transition (void)
+{
+  static int const counts[] = { 1, 8, 64, 512 };
+  bench_device_t* devs;
+  transition_t tr;
+  long long start, best, best_ref;
+  char what[64];
+  int c, n, i, r, step, steps;
+
+  for (c = 0; c < (int) (sizeof (counts) / sizeof (*counts)); c++)
+    {
+      n = counts[c];
+      steps = BENCH_STEPS / n + 1;
+
+      if (!transition_init (&tr, n) || !(devs = calloc (n, sizeof (*devs))))
+        {
+          eprintf ("%s", strerror (errno));
+          exit (EXIT_FAILURE);
+        }
+
+      // Every device runs a fade of its own, the times stay within one
+      // transition so that no loop takes its short way.
+      for (i = 0; i < n; i++)
+        {
+          tr.current[i] = devs[i].current = devs[i].from = rand () % 1000;
+          tr.target[i] = devs[i].target = rand () % 1000;
+          devs[i].transition = BENCH_DURATION + i % 16;
+          transition_begin (&tr, i, 0, devs[i].transition, SCHED_TICK);
+        }
+
+      for (best = best_ref = -1, r = 0; r < BENCH_ROUNDS; r++)
+        {
+          start = bench_now ();
+
+          for (step = 0; step < steps; step++)
+            transition_step (&tr, n, step % BENCH_DURATION);
+
+          start = bench_now () - start;
+          best = (best < 0) ? start : MIN (best, start);
+          bench_sink = tr.value[n - 1];
+
+          start = bench_now ();
+
+          for (step = 0; step < steps; step++)
+            for (i = 0; i < n; i++)
+              {
+                bench_device_t* dev = devs + i;
+                long long elapsed = step % BENCH_DURATION - dev->start;
+
+                if (dev->current == dev->target)
+                  continue;
+                else if (elapsed >= dev->transition)
+                  dev->value = dev->target;
+                else
+                  dev->value = dev->from
+                               + (dev->target - dev->from) * elapsed
+                                     / dev->transition;
+              }
+
+          start = bench_now () - start;
+          best_ref = (best_ref < 0) ? start : MIN (best_ref, start);
+          bench_sink = devs[n - 1].value;
+        }
+
+      snprintf (what, sizeof (what), "transition_step %d devs", n);
+      bench_report (what, best, (long long) steps * n);
+      snprintf (what, sizeof (what), "per-device loop %d devs", n);
+      bench_report (what, best_ref, (long long) steps * n);
+
+      transition_clear (&tr);
+      free (devs);
+    }
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static long long
+bench_cputime (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void*
+bench_publish (void* data)
+{
+  bench_writer_t* self = (bench_writer_t*) data;
+  statpage_t* page = self->page;
+  long long start;
+  int value = 0;
+
+  // Publishes as fast as it can, like a device thread at a tick of zero.
+  // The wait is the CPU time it burns for the page, not the time it was
+  // preempted meanwhile.
+  while (atomic_load (&bench_running))
+    {
+      start = bench_cputime ();
+      statpage_begin (page);
+      self->worst = MAX (self->worst, bench_cputime () - start);
+      page->devs[0].value = value++;
+      page->devs[0].progress = value % 1000;
+      statpage_end (page);
+    }
+
+  return null;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_statpage (void)
+{
+  static int const counts[] = { 1, 64 };
+  statpage_device_t devs[SCHED_MAX_DEVICES];
+  char path[] = "/tmp/backlight-bench.XXXXXX";
+  statpage_t const* reader;
+  statpage_t* page;
+  bench_writer_t writers[2];
+  pthread_t writer, writers_ids[2];
+  long long start, best;
+  char what[64];
+  int c, i, r, fd, failed;
+
+  if ((fd = mkstemp (path)) < 0 || !(page = statpage_create (path))
+      || !(reader = statpage_open (path)))
+    {
+      eprintf ("%s: %s", path, strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  writers[0].page = writers[1].page = page;
+  writers[0].worst = writers[1].worst = 0;
+
+  for (c = 0; c < (int) (sizeof (counts) / sizeof (*counts)); c++)
+    {
+      statpage_begin (page);
+      page->n_devs = counts[c];
+      statpage_end (page);
+
+      for (best = -1, r = 0; r < BENCH_ROUNDS; r++)
+        {
+          start = bench_now ();
+
+          for (i = 0; i < BENCH_READS; i++)
+            bench_sink = statpage_read (reader, devs, SCHED_MAX_DEVICES);
+
+          start = bench_now () - start;
+          best = (best < 0) ? start : MIN (best, start);
+        }
+
+      snprintf (what, sizeof (what), "statpage_read %d devs", counts[c]);
+      bench_report (what, best, BENCH_READS);
+    }
+
+  // A reader that meets a write copies the page again, it gives up only
+  // after STATPAGE_RETRIES of them.
+  atomic_store (&bench_running, true);
+  pthread_create (&writer, null, bench_publish, writers);
+
+  for (failed = 0, i = 0, start = bench_now (); i < BENCH_READS; i++)
+    failed += (statpage_read (reader, devs, SCHED_MAX_DEVICES) < 0);
+
+  start = bench_now () - start;
+  atomic_store (&bench_running, false);
+  pthread_join (writer, null);
+
+  snprintf (what, sizeof (what), "statpage_read 64 devs, writing");
+  bench_report (what, start, BENCH_READS);
+  printf ("%-32s %10d of %d\n", "  gave up", failed, BENCH_READS);
+
+  // The two threads of the server write the page too, one that is
+  // preempted holding it must not cost the other its time slice.
+  atomic_store (&bench_running, true);
+
+  for (i = 0; i < 2; i++)
+    {
+      writers[i].worst = 0;
+      pthread_create (writers_ids + i, null, bench_publish, writers + i);
+    }
+
+  usleep (300000);
+  atomic_store (&bench_running, false);
+
+  for (i = 0; i < 2; i++)
+    pthread_join (writers_ids[i], null);
+
+  printf ("%-32s %10.1f us\n", "statpage_begin, 2 writers, worst",
+          MAX (writers[0].worst, writers[1].worst) / 1000.0);
+
+  // The value of a device as the daemon reads it, for comparison.
+  statpage_begin (page);
+  page->n_devs = 1;
+  statpage_end (page);
+
+  if (pwrite (fd, "500\n", 4, 0) == 4)
+    {
+      char buf[16];
+
+      for (best = -1, r = 0; r < BENCH_ROUNDS; r++)
+        {
+          start = bench_now ();
+
+          for (i = 0; i < BENCH_READS / 10; i++)
+            bench_sink = pread (fd, buf, sizeof (buf), 0);
+
+          start = bench_now () - start;
+          best = (best < 0) ? start : MIN (best, start);
+        }
+
+      bench_report ("pread of a value", best, BENCH_READS / 10);
+    }
+
+  statpage_close (reader);
+  statpage_destroy (page);
+  unlink (path);
+  close (fd);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void*
+bench_produce (void* data)
+{
+  cmdring_cmd_t cmd = { 0 };
+  int i;
+
+  // Each producer numbers its commands, the consumer checks their order.
+  cmd.field = (int) (intptr_t) data;
+
+  for (i = 0; i < BENCH_COMMANDS / BENCH_PRODUCERS; i++)
+    {
+      cmd.value = i;
+
+      while (!cmdring_push (bench_ring, &cmd))
+        sched_yield ();
+    }
+
+  return null;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_cmdring (void)
+{
+  pthread_t producers[BENCH_PRODUCERS];
+  int next[BENCH_PRODUCERS] = { 0 };
+  cmdring_cmd_t cmd = { 0 };
+  long long start, best;
+  uint64_t one = 1;
+  int i, r, fd, wake, socks[2], got, disorder;
+
+  if (!(bench_ring = cmdring_create (&fd))
+      || (wake = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0
+      || socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, socks) < 0)
+    {
+      eprintf ("%s", strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  for (best = -1, r = 0; r < BENCH_ROUNDS; r++)
+    {
+      start = bench_now ();
+
+      for (i = 0; i < BENCH_COMMANDS; i++)
+        {
+          cmdring_push (bench_ring, &cmd);
+          cmdring_pop (bench_ring, &cmd);
+        }
+
+      start = bench_now () - start;
+      best = (best < 0) ? start : MIN (best, start);
+    }
+
+  bench_report ("cmdring push+pop", best, BENCH_COMMANDS);
+
+  // A client wakes the server with the eventfd after each command.
+  for (best = -1, r = 0; r < BENCH_ROUNDS; r++)
+    {
+      start = bench_now ();
+
+      for (i = 0; i < BENCH_COMMANDS / 10; i++)
+        {
+          cmdring_push (bench_ring, &cmd);
+          bench_sink = write (wake, &one, sizeof (one));
+          bench_sink = read (wake, &one, sizeof (one));
+          cmdring_pop (bench_ring, &cmd);
+        }
+
+      start = bench_now () - start;
+      best = (best < 0) ? start : MIN (best, start);
+    }
+
+  bench_report ("cmdring push+wake+pop", best, BENCH_COMMANDS / 10);
+
+  // The same command through a stream socket, for comparison.
+  for (best = -1, r = 0; r < BENCH_ROUNDS; r++)
+    {
+      start = bench_now ();
+
+      for (i = 0; i < BENCH_COMMANDS / 10; i++)
+        {
+          bench_sink = write (socks[0], &cmd, sizeof (cmd));
+          bench_sink = read (socks[1], &cmd, sizeof (cmd));
+        }
+
+      start = bench_now () - start;
+      best = (best < 0) ? start : MIN (best, start);
+    }
+
+  bench_report ("socket write+read", best, BENCH_COMMANDS / 10);
+
+  // The producers race for the slots while the ring is drained.
+  start = bench_now ();
+
+  for (i = 0; i < BENCH_PRODUCERS; i++)
+    pthread_create (producers + i, null, bench_produce, (void*) (intptr_t) i);
+
+  for (got = disorder = 0; got < BENCH_COMMANDS / BENCH_PRODUCERS
+                                     * BENCH_PRODUCERS;)
+    if (!cmdring_pop (bench_ring, &cmd))
+      sched_yield ();
+    else
+      {
+        disorder += (cmd.value != next[cmd.field]);
+        next[cmd.field] = cmd.value + 1;
+        got++;
+      }
+
+  for (i = 0; i < BENCH_PRODUCERS; i++)
+    pthread_join (producers[i], null);
+
+  start = bench_now () - start;
+  bench_report ("cmdring 4 producers", start, got);
+  printf ("%-32s %10d of %d\n", "  out of order", disorder, got);
+
+  // A producer killed between its claim and its write leaves the slot,
+  // the command behind it comes once the slot is given up.
+  atomic_fetch_add (&bench_ring->head, 1);
+  cmd.value = 42;
+  cmdring_push (bench_ring, &cmd);
+  bench_expect (!cmdring_pop (bench_ring, &cmd)
+                    && cmdring_deadline (bench_ring) > 0,
+                "cmdring waits for a claimed slot");
+  usleep (CMDRING_STALL / 1000 + 10000);
+  bench_expect (cmdring_pop (bench_ring, &cmd) && cmd.value == 42
+                    && cmdring_deadline (bench_ring) < 0,
+                "  skips it after CMDRING_STALL");
+
+  cmdring_destroy (bench_ring);
+  close (fd);
+  close (wake);
+  close (socks[0]);
+  close (socks[1]);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+bench_receive (int sock, message_t* msgs, int count)
+{
+  char ctls[BENCH_BATCH][CMSG_SPACE (sizeof (struct ucred))]
+      __attribute__ ((aligned (sizeof (size_t))));
+  struct mmsghdr hdrs[BENCH_BATCH];
+  struct iovec iovs[BENCH_BATCH];
+  struct cmsghdr* cmsg;
+  int i, n, senders = 0;
+
+  // Set up as server_receive() does it, the sender of each one is found.
+  for (i = 0; i < count; i++)
+    {
+      iovs[i].iov_base = msgs + i;
+      iovs[i].iov_len = sizeof (*msgs);
+      memset (&hdrs[i].msg_hdr, 0, sizeof (hdrs[i].msg_hdr));
+      hdrs[i].msg_hdr.msg_iov = iovs + i;
+      hdrs[i].msg_hdr.msg_iovlen = 1;
+      hdrs[i].msg_hdr.msg_control = ctls[i];
+      hdrs[i].msg_hdr.msg_controllen = sizeof (ctls[i]);
+    }
+
+  if (count == 1)
+    n = (recvmsg (sock, &hdrs[0].msg_hdr, MSG_DONTWAIT) == sizeof (*msgs));
+  else
+    n = recvmmsg (sock, hdrs, count, MSG_DONTWAIT, null);
+
+  for (i = 0; i < n; i++)
+    for (cmsg = CMSG_FIRSTHDR (&hdrs[i].msg_hdr); cmsg;
+         cmsg = CMSG_NXTHDR (&hdrs[i].msg_hdr, cmsg))
+      senders += (cmsg->cmsg_level == SOL_SOCKET
+                  && cmsg->cmsg_type == SCM_CREDENTIALS);
+
+  return senders;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_dgram (void)
+{
+  static int const batches[] = { 1, BENCH_BATCH };
+  message_t msgs[BENCH_BATCH];
+  message_t msg = MESSAGE_INIT;
+  long long start, best, best_recv, recv_start, took;
+  char what[64];
+  int b, i, j, r, on = 1, got, dgram[2], stream[2];
+
+  if (socketpair (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, dgram) < 0
+      || socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, stream) < 0
+      || setsockopt (dgram[1], SOL_SOCKET, SO_PASSCRED, &on, sizeof (on)) < 0)
+    {
+      eprintf ("%s", strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  msg.field = FIELD_INC;
+
+  // A client sends its datagram and is gone, the server takes what has
+  // queued up meanwhile in one call.
+  for (b = 0; b < (int) (sizeof (batches) / sizeof (*batches)); b++)
+    {
+      for (best = best_recv = -1, got = 0, r = 0; r < BENCH_ROUNDS; r++)
+        {
+          start = bench_now ();
+
+          for (took = 0, i = 0; i < BENCH_COMMANDS / 10; i += batches[b])
+            {
+              for (j = 0; j < batches[b]; j++)
+                bench_sink = send (dgram[0], &msg, sizeof (msg), 0);
+
+              recv_start = bench_now ();
+              got += bench_receive (dgram[1], msgs, batches[b]);
+              took += bench_now () - recv_start;
+            }
+
+          start = bench_now () - start;
+          best = (best < 0) ? start : MIN (best, start);
+          best_recv = (best_recv < 0) ? took : MIN (best_recv, took);
+        }
+
+      snprintf (what, sizeof (what), "dgram, %d per receive", batches[b]);
+      bench_report (what, best, BENCH_COMMANDS / 10);
+      bench_report ("  of it the receive", best_recv, BENCH_COMMANDS / 10);
+
+      if (got != BENCH_ROUNDS * (BENCH_COMMANDS / 10))
+        printf ("%-32s %10d of %d\n", "  without a sender", got,
+                BENCH_ROUNDS * (BENCH_COMMANDS / 10));
+    }
+
+  // The stream socket answers each command.
+  for (best = -1, r = 0; r < BENCH_ROUNDS; r++)
+    {
+      start = bench_now ();
+
+      for (i = 0; i < BENCH_COMMANDS / 10; i++)
+        {
+          bench_sink = write (stream[0], &msg, sizeof (msg));
+          bench_sink = read (stream[1], msgs, sizeof (msg));
+          bench_sink = write (stream[1], msgs, sizeof (msg));
+          bench_sink = read (stream[0], &msg, sizeof (msg));
+        }
+
+      start = bench_now () - start;
+      best = (best < 0) ? start : MIN (best, start);
+    }
+
+  bench_report ("stream, request and answer", best, BENCH_COMMANDS / 10);
+
+  close (dgram[0]);
+  close (dgram[1]);
+  close (stream[0]);
+  close (stream[1]);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+bench_sched (void)
+{
+  static devio_backend_t const backend = { bench_device_read,
+                                           bench_device_write, null };
+  int sets[BENCH_DEVICES], values[BENCH_DEVICES];
+  long long start;
+  sched_t sched;
+  int i, n, fd;
+
+  // The device thread runs on devices in memory, a descriptor of
+  // /dev/null stands for each attribute.
+  if (!sched_init (&sched))
+    {
+      eprintf ("%s", strerror (errno));
+      exit (EXIT_FAILURE);
+    }
+
+  devio_set_backend (&sched.io, &backend);
+
+  for (i = 0; i < BENCH_DEVICES; i++)
+    if ((fd = sets[i] = open ("/dev/null", O_RDWR | O_CLOEXEC)) < 0
+        || fd >= BENCH_FDS
+        || !sched_set_device (&sched, i, fd, dup (fd), -1, -1, 1000,
+                              SCHED_TICK))
+      {
+        eprintf ("%s", "The devices can not be set up");
+        exit (EXIT_FAILURE);
+      }
+
+  // A stop that hangs is reported by the alarm instead of a failure.
+  alarm (10);
+  sched_start (&sched);
+
+  for (i = 0; i < BENCH_DEVICES; i++)
+    sched_set_target (&sched, i, 1000, 2000, 0);
+
+  sched_commit (&sched);
+  usleep (200000);
+
+  start = bench_now ();
+  sched_stop (&sched);
+  start = bench_now () - start;
+
+  printf ("%-32s %10.1f us\n", "sched_stop while moving", start / 1000.0);
+  bench_expect (bench_values[sets[0]] > 0 && bench_values[sets[0]] < 1000,
+                "  the devices were moving");
+
+  for (i = 0; i < BENCH_DEVICES; i++)
+    values[i] = bench_values[sets[i]];
+
+  usleep (50000);
+
+  for (i = 0; i < BENCH_DEVICES && values[i] == bench_values[sets[i]]; i++)
+    ;
+
+  bench_expect (i == BENCH_DEVICES, "  nothing written after it");
+
+  // The updates that find the queue full are refused and the caller
+  // keeps its state, the queue takes them again once it is drained.
+  sched_start (&sched);
+
+  for (n = 0; sched_set_target (&sched, n % BENCH_DEVICES, 0, 0, 0); n++)
+    ;
+
+  printf ("%-32s %10d\n", "updates queued until full", n);
+  sched_commit (&sched);
+  usleep (50000);
+  bench_expect (sched_set_target (&sched, 0, 0, 0, 0),
+                "  taken again after a drain");
+
+  // The queue is filled without a commit, so the thread sleeps on it.
+  while (sched_set_target (&sched, 0, 500, 2000, 0))
+    ;
+
+  start = bench_now ();
+  sched_stop (&sched);
+  start = bench_now () - start;
+  alarm (0);
+
+  printf ("%-32s %10.1f us\n", "sched_stop with a full queue",
+          start / 1000.0);
+  bench_expect (!sched.started, "  joined");
+
+  sched_clear (&sched);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bench_t const benches[] = {
+  { "transition", bench_transition },
+  { "statpage", bench_statpage },
+  { "cmdring", bench_cmdring },
+  { "dgram", bench_dgram },
+  { "sched", bench_sched },
+  { null, null },
+};
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+main (int argc, char** argv)
+{
+  bench_t const* it;
+  int i;
+
+  // What was done is seen even when the alarm ends a hung check.
+  setvbuf (stdout, null, _IOLBF, 0);
+
+  for (it = benches; it->name; it++)
+    {
+      for (i = 1; i < argc && strcmp (argv[i], it->name); i++)
+        ;
+
+      if (argc == 1 || i < argc)
+        it->run ();
+    }
+
+  return bench_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
@@ -0,0 +1,173 @@
+/*
+ * blctl_check.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Drives a running daemon through libbacklightctl alone, with nothing of
+// the tree but backlightctl.h, so it is built against the exported API
+// only. The commands leave the brightness as it was. Each step prints
+// its result and the program fails on the first one that goes wrong.
+//
+//   blctl-check [SOCKET] [COUNT]
+//
+// COUNT commands are timed one by one and pipelined, the daemon should
+// run with --rate-limit 0 for that.
+#include "backlightctl.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define CHECK_COUNT 1000
+#define CHECK_TIMEOUT 1000
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+typedef struct check_t
+{
+  int answered;
+  int failed;
+  int added;
+} check_t;
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static long long
+check_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+check_fail (char const* step, char const* reason)
+{
+  fprintf (stderr, "%s: FAILED: %s\n", step, reason);
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+check_reply (blctl_t* ctl __attribute__ ((unused)), int status,
+             char const* text __attribute__ ((unused)), void* data)
+{
+  check_t* self = (check_t*) data;
+
+  self->answered++;
+  self->failed += (status != 0);
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+check_event (blctl_t* ctl __attribute__ ((unused)), blctl_event_t const* ev,
+             void* data)
+{
+  check_t* self = (check_t*) data;
+
+  if (ev->type != BLCTL_EVENT_ADDED)
+    return;
+
+  printf ("watch: %s %d/%d\n", ev->device, ev->value, ev->max);
+  self->added++;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static int
+check_wait (blctl_t* ctl, int const* counter, int goal)
+{
+  struct pollfd ps = { blctl_fd (ctl), POLLIN, 0 };
+
+  // The callbacks count what has come, each wait has the same timeout.
+  while (*counter < goal)
+    {
+      if (poll (&ps, 1, CHECK_TIMEOUT) <= 0 || blctl_dispatch (ctl) < 0)
+        return 0;
+
+      ps.fd = blctl_fd (ctl);
+    }
+
+  return 1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+main (int argc, char** argv)
+{
+  char reply[4096];
+  check_t check = { 0, 0, 0 };
+  blctl_t *ctl, *watch;
+  long long start, took;
+  int count, i;
+
+  count = (argc > 2) ? atoi (argv[2]) : CHECK_COUNT;
+  ctl = blctl_open (argc > 1 ? argv[1] : NULL);
+
+  if (!ctl)
+    return check_fail ("open", strerror (errno));
+  else if (blctl_fd (ctl) < 0)
+    return check_fail ("open", strerror (errno));
+
+  if (blctl_call (ctl, "saved", reply, sizeof (reply)) < 0)
+    return check_fail ("call", reply);
+
+  printf ("call: saved %s\n", reply);
+
+  // A bad command is answered with the error, the connection goes on.
+  if (blctl_call (ctl, "no-such-command", reply, sizeof (reply)) == 0)
+    return check_fail ("error", "a bad command was accepted");
+
+  printf ("error: %s\n", reply);
+
+  start = check_now ();
+
+  for (i = 0; i < count; i++)
+    if (blctl_call (ctl, "saved", NULL, 0) < 0)
+      return check_fail ("sync", "a command failed, is the rate limited?");
+
+  took = check_now () - start;
+  printf ("sync: %d calls, %.1f us/call\n", count, took / 1000.0 / count);
+
+  // The commands are sent as fast as the queue of the handle takes them,
+  // the answers are collected meanwhile.
+  start = check_now ();
+
+  for (i = 0; i < count;)
+    if (blctl_call_async (ctl, "saved", check_reply, &check) == 0)
+      i++;
+    else if (!check_wait (ctl, &check.answered, check.answered + 1))
+      return check_fail ("async", "no answer");
+
+  if (!check_wait (ctl, &check.answered, count) || check.failed)
+    return check_fail ("async", "lost or failed answers");
+
+  took = check_now () - start;
+  printf ("async: %d calls, %.0f calls/s\n", count, count * 1e9 / took);
+
+  // The devices of the daemon come first to a new subscriber.
+  if (!(watch = blctl_open (argc > 1 ? argv[1] : NULL))
+      || blctl_watch (watch, -1, check_event, &check) < 0
+      || !check_wait (watch, &check.added, 1))
+    return check_fail ("watch", "no device was announced");
+
+  if (blctl_call_async (watch, "saved", check_reply, &check) == 0)
+    return check_fail ("watch", "a watching handle took a command");
+
+  blctl_close (watch);
+  blctl_close (ctl);
+  printf ("%s\n", "OK");
+
+  return 0;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
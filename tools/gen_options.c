@@ -0,0 +1,162 @@
+/*
+ * gen_options.c
+ *
+ *  Created on: 19 Oct. 2026 г.
+ *      Author: Voldemar Khramtsov <harestomper@gmail.com>
+ *
+ */
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Writes opthash.c, the perfect hash table of the long option names, for
+// the options table and the fields of the MAKE list the program is built
+// with. Run by the build, see CMakeLists.txt.
+#include "includes.h"
+
+#include <stdlib.h>
+#include <string.h>
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+#define MAX_SEED 1000000
+#define MAX_SIZE 4096
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+try_seed (option_t const* opts, short* table, int size, unsigned seed)
+{
+  option_t const* it;
+  int slot;
+
+  for (slot = 0; slot < size; slot++)
+    table[slot] = -1;
+
+  for (it = opts; it->field != FIELD_NONE; it++)
+    {
+      if (!it->long_name)
+        continue;
+
+      slot = opthash_hash (it->long_name, strlen (it->long_name), seed)
+             & (size - 1);
+
+      if (table[slot] >= 0)
+        return false;
+
+      table[slot] = it - opts;
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static bool_t
+check_options (option_t const* opts)
+{
+  option_t const *it, *other;
+
+  for (it = opts; it->field != FIELD_NONE; it++)
+    {
+      if (it->field >= FIELD_NUM)
+        {
+          fprintf (stderr, "Option '%s' has no field\n", it->long_name);
+          return false;
+        }
+
+      for (other = opts; other < it && it->long_name; other++)
+        if (other->long_name && !strcmp (other->long_name, it->long_name))
+          {
+            fprintf (stderr, "Option '%s' is defined twice\n", it->long_name);
+            return false;
+          }
+    }
+
+  return true;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+static void
+write_table (FILE* out, short const* table, int size, unsigned seed)
+{
+  int i;
+
+  fprintf (out, "/*\n * opthash.c\n *\n"
+                " * Generated by gen_options from the options table, "
+                "do not edit.\n *\n */\n");
+  fprintf (out, "#include \"includes.h\"\n\n#include <string.h>\n\n");
+  fprintf (out, "#define OPTHASH_SEED %uu\n#define OPTHASH_SIZE %d\n\n", seed,
+           size);
+  fprintf (out, "static short const opthash_table[OPTHASH_SIZE] = {");
+
+  for (i = 0; i < size; i++)
+    fprintf (out, "%s%d,", (i % 12) ? " " : "\n  ", table[i]);
+
+  fprintf (out, "\n};\n\n");
+  fprintf (out,
+           "option_t const*\n"
+           "opthash_find (char const* name, int len)\n"
+           "{\n"
+           "  option_t const* opt;\n"
+           "  int i;\n\n"
+           "  i = opthash_table[opthash_hash (name, len, OPTHASH_SEED)\n"
+           "                    & (OPTHASH_SIZE - 1)];\n\n"
+           "  if (i < 0)\n"
+           "    return null;\n\n"
+           "  opt = statics_options + i;\n\n"
+           "  if (strncmp (opt->long_name, name, len) || opt->long_name[len])\n"
+           "    return null;\n\n"
+           "  return opt;\n"
+           "}\n");
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+int
+main (int argc, char** argv)
+{
+  option_t const* opts = statics_options;
+  short table[MAX_SIZE];
+  unsigned seed = 0;
+  int n, size;
+  FILE* out;
+
+  if (argc != 2)
+    {
+      fprintf (stderr, "Usage: %s OUTPUT\n", argv[0]);
+      return 2;
+    }
+
+  if (!check_options (opts))
+    return 1;
+
+  for (n = 0; opts[n].field != FIELD_NONE; n++)
+    continue;
+
+  // The table is kept at most half full, it grows when no seed fits.
+  for (size = 1; size < n * 2; size <<= 1)
+    continue;
+
+  for (; size <= MAX_SIZE; size <<= 1)
+    {
+      for (seed = 0; seed < MAX_SEED && !try_seed (opts, table, size, seed);
+           seed++)
+        continue;
+
+      if (seed < MAX_SEED)
+        break;
+    }
+
+  if (size > MAX_SIZE)
+    {
+      fprintf (stderr, "%s", "No perfect hash for the options\n");
+      return 1;
+    }
+
+  if (!(out = fopen (argv[1], "w")))
+    {
+      perror (argv[1]);
+      return 1;
+    }
+
+  write_table (out, table, size, seed);
+
+  return (fclose (out) == 0) ? 0 : 1;
+}
+//------------------------------------------------------------------------------
+//------------------------------------------------------------------------------